@@ -24,20 +24,40 @@ class Acceptor {
 
   auto stop() -> void;
 
+  // next_loop picks the loop of the next connection on the acceptor's
+  // thread; new_session makes its session on that loop's thread.
   auto setNewSessionCallback(
-      std::function<std::shared_ptr<Session>()> new_session_callback) -> void;
+      std::function<std::shared_ptr<Loop>()> next_loop,
+      std::function<std::shared_ptr<Session>(const std::shared_ptr<Loop>&)>
+          new_session) -> void;
+
+  // Hand every new session to coroutine (see Session::spawn) instead of
+  // starting its callback read loop.
+  auto setSessionCoroutine(
+      std::function<asio::awaitable<void>(std::shared_ptr<Session>)>
+          coroutine) -> void;
 
  private:
   auto listen() -> void;
 
   auto accept() -> void;
 
+  auto acceptLoop() -> asio::awaitable<void>;
+
+  // Posted to loop: the session is acquired and started on its own thread.
+  auto handOver(std::shared_ptr<Loop> loop, asio::ip::tcp::socket socket)
+      -> void;
+
  private:
   std::shared_ptr<Loop> _loop;
   asio::ip::tcp::acceptor _acceptor;
   std::string _ip;
   std::uint16_t _port;
-  std::function<std::shared_ptr<Session>()> _new_session_callback;
+  std::function<std::shared_ptr<Loop>()> _next_loop;
+  std::function<std::shared_ptr<Session>(const std::shared_ptr<Loop>&)>
+      _new_session_callback;
+  std::function<asio::awaitable<void>(std::shared_ptr<Session>)>
+      _session_coroutine;
 };
 
 }  // namespace fz::net
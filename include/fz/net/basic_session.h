@@ -0,0 +1,75 @@
+#ifndef __FZ_NET_BASIC_SESSION_H__
+#define __FZ_NET_BASIC_SESSION_H__
+
+#include <concepts>
+#include <memory>
+#include <utility>
+
+#include "fz/net/common/buffer.h"
+#include "fz/net/loop.h"
+#include "fz/net/session.h"
+
+namespace fz::net {
+
+template <typename Handler>
+class BasicSession;
+
+// Per-connection protocol logic for BasicSession. onRead() is required;
+// onConnect() and onDisconnect() are called when present. Session pools
+// build sessions without handler arguments, hence default_initializable.
+template <typename Handler>
+concept SessionHandler =
+    std::movable<Handler> && std::default_initializable<Handler> &&
+    requires(Handler& handler, BasicSession<Handler>& session, Buffer& buffer) {
+      handler.onRead(session, buffer);
+    };
+
+// Session whose events go to a Handler object it owns. The read path is
+// still Session's and reaches the handler through one virtual call; only
+// the handler body is bound statically, with no std::function, shared_ptr
+// copy or dynamic_pointer_cast per read. Pooled sessions reset the handler
+// with its reset() if it has one, else assign a default constructed one.
+template <typename Handler>
+class BasicSession final : public Session {
+ public:
+  template <typename... Args>
+  explicit BasicSession(std::shared_ptr<Loop> loop, Args&&... args)
+      : Session{std::move(loop)}, _handler{std::forward<Args>(args)...} {}
+
+  auto handler() -> Handler& { return _handler; }
+
+  auto handler() const -> const Handler& { return _handler; }
+
+  auto reset() -> void override {
+    Session::reset();
+    if constexpr (requires { _handler.reset(); }) {
+      _handler.reset();
+    } else {
+      _handler = Handler{};
+    }
+  }
+
+ private:
+  auto onConnect() -> void override {
+    if constexpr (requires { _handler.onConnect(*this); }) {
+      _handler.onConnect(*this);
+    }
+  }
+
+  auto onRead(Buffer& buffer) -> void override {
+    _handler.onRead(*this, buffer);
+  }
+
+  auto onDisconnect() -> void override {
+    if constexpr (requires { _handler.onDisconnect(*this); }) {
+      _handler.onDisconnect(*this);
+    }
+  }
+
+ private:
+  Handler _handler;
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_BASIC_SESSION_H__
@@ -0,0 +1,53 @@
+#ifndef __FZ_NET_BASIC_TCP_SERVER_H__
+#define __FZ_NET_BASIC_TCP_SERVER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "fz/net/basic_session.h"
+#include "fz/net/tcp_server.h"
+
+namespace fz::net {
+
+// TcpServer whose connections are BasicSession<Handler>: connect, read and
+// disconnect go to each session's handler, the other settings are TcpServer's.
+template <typename Handler>
+  requires SessionHandler<Handler>
+class BasicTcpServer : private TcpServer {
+ public:
+  BasicTcpServer(std::size_t loop_pool_size, std::string_view ip,
+                 std::uint16_t port, LoopPoolOptions options = {})
+      : TcpServer{loop_pool_size, ip, port, std::move(options)} {
+    setNewSessionCallback<BasicSession<Handler>>();
+  }
+
+  using TcpServer::start;
+
+  using TcpServer::stop;
+
+  using TcpServer::setHighWaterMarkCallback;
+
+  using TcpServer::setWriteCompleteCallback;
+
+  using TcpServer::setIdleTimeout;
+
+  using TcpServer::setSharedReadBuffer;
+
+  using TcpServer::setSocketBusyPoll;
+
+  using TcpServer::setSessionCoroutine;
+
+  using TcpServer::loops;
+
+  using TcpServer::sessions;
+
+  using TcpServer::broadcast;
+
+  using TcpServer::sessionCount;
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_BASIC_TCP_SERVER_H__
@@ -0,0 +1,105 @@
+#ifndef __FZ_NET_CODEC_H__
+#define __FZ_NET_CODEC_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "fz/net/common/buffer.h"
+
+namespace fz::net {
+
+// Splits received bytes into messages and frames outgoing ones. Stateless,
+// so one instance can be shared by every session of a server.
+class Codec {
+ public:
+  constexpr static std::size_t DEFAULT_MAX_FRAME = 16 * 1024 * 1024;
+
+  enum class Status : std::uint8_t { Complete, Incomplete, Invalid };
+
+  struct Frame {
+    std::string_view message;  // view into the receive buffer
+    std::size_t size{};        // bytes of the buffer the frame occupies
+  };
+
+ public:
+  Codec() = default;
+
+  Codec(const Codec&) = default;
+
+  Codec(Codec&&) noexcept = default;
+
+  auto operator=(const Codec&) -> Codec& = default;
+
+  auto operator=(Codec&&) noexcept -> Codec& = default;
+
+  virtual ~Codec() = default;
+
+  // On Complete, frame points into buffer until it changes. Invalid means
+  // the stream cannot be parsed further, e.g. a frame above the limit.
+  [[nodiscard]] virtual auto decode(const Buffer& buffer, Frame& frame) const
+      -> Status = 0;
+
+  // Frame message for sending; empty if it does not fit into one frame.
+  [[nodiscard]] virtual auto encode(std::string_view message) const
+      -> Buffer = 0;
+};
+
+// Messages preceded by their length in a 1, 2, 4 or 8 byte integer. The
+// length counts the message only, not the field itself.
+class LengthFieldCodec : public Codec {
+ public:
+  enum class ByteOrder : std::uint8_t { BigEndian, LittleEndian };
+
+ public:
+  // field_size other than 1, 2, 4 or 8 is rounded up to the next of them.
+  explicit LengthFieldCodec(std::size_t field_size = 4,
+                            ByteOrder byte_order = ByteOrder::BigEndian,
+                            std::size_t max_frame = DEFAULT_MAX_FRAME);
+
+  [[nodiscard]] auto fieldSize() const { return _field_size; }
+
+  [[nodiscard]] auto byteOrder() const { return _byte_order; }
+
+  [[nodiscard]] auto maxFrame() const { return _max_frame; }
+
+  [[nodiscard]] auto decode(const Buffer& buffer, Frame& frame) const
+      -> Status override;
+
+  [[nodiscard]] auto encode(std::string_view message) const
+      -> Buffer override;
+
+ private:
+  std::size_t _field_size;
+  ByteOrder _byte_order;
+  std::size_t _max_frame;
+};
+
+// Messages terminated by a delimiter, "\r\n" by default. The delimiter is
+// not part of the decoded message.
+class LineCodec : public Codec {
+ public:
+  explicit LineCodec(std::string_view delimiter = "\r\n",
+                     std::size_t max_frame = DEFAULT_MAX_FRAME);
+
+  [[nodiscard]] auto delimiter() const -> std::string_view {
+    return _delimiter;
+  }
+
+  [[nodiscard]] auto maxFrame() const { return _max_frame; }
+
+  [[nodiscard]] auto decode(const Buffer& buffer, Frame& frame) const
+      -> Status override;
+
+  [[nodiscard]] auto encode(std::string_view message) const
+      -> Buffer override;
+
+ private:
+  std::string _delimiter;
+  std::size_t _max_frame;
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_CODEC_H__
@@ -1,49 +1,156 @@
 #ifndef __FZ_NET_BUFFER_H__
 #define __FZ_NET_BUFFER_H__
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
-#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "fz/net/common/buffer_pool.h"
+#include "fz/net/common/search.h"
 
 namespace fz::net {
 
+// Byte buffer in a lazily allocated, never zero-filled BufferPool chunk.
+// The first prependSize() bytes are kept free for headers:
+//
+// | prependable bytes |  readable bytes  |  writable bytes  |
+// 0            _reader_pos        _writer_pos          capacity
 class Buffer {
  public:
   static constexpr std::size_t DEFAULT_SIZE = 1024;
 
-  [[nodiscard]] auto capacity() const { return _buffer.size(); }
+  static constexpr std::size_t CHEAP_PREPEND = 8;
+
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  Buffer() = default;
+
+  explicit Buffer(std::size_t prepend_size) : _prepend_size{prepend_size} {}
+
+  Buffer(const Buffer& other) : _prepend_size{other._prepend_size} {
+    auto readable = other._writer_pos - other._reader_pos;
+    if (readable != 0) {
+      reallocate(_prepend_size + readable, _prepend_size);
+      std::copy(other._buffer + other._reader_pos,
+                other._buffer + other._writer_pos, _buffer + _reader_pos);
+      _writer_pos += readable;
+    }
+  }
+
+  Buffer(Buffer&& other) noexcept
+      : _writer_pos{std::exchange(other._writer_pos, 0)},
+        _reader_pos{std::exchange(other._reader_pos, 0)},
+        _capacity{std::exchange(other._capacity, 0)},
+        _prepend_size{other._prepend_size},
+        _buffer{std::exchange(other._buffer, nullptr)} {}
+
+  auto operator=(const Buffer& other) -> Buffer& {
+    if (this != &other) {
+      auto copy = other;
+      swap(copy);
+    }
+    return *this;
+  }
+
+  auto operator=(Buffer&& other) noexcept -> Buffer& {
+    auto moved = std::move(other);
+    swap(moved);
+    return *this;
+  }
+
+  ~Buffer() { BufferPool::deallocate(_buffer, _capacity); }
+
+  auto swap(Buffer& other) noexcept -> void {
+    std::swap(_writer_pos, other._writer_pos);
+    std::swap(_reader_pos, other._reader_pos);
+    std::swap(_capacity, other._capacity);
+    std::swap(_prepend_size, other._prepend_size);
+    std::swap(_buffer, other._buffer);
+  }
+
+  [[nodiscard]] auto capacity() const { return _capacity; }
 
   [[nodiscard]] auto empty() const { return _writer_pos == _reader_pos; }
 
-  [[nodiscard]] auto full() const { return _writer_pos == _buffer.size(); }
+  [[nodiscard]] auto full() const { return _writer_pos == _capacity; }
 
-  [[nodiscard]] auto writeableBytes() const { return _buffer.size() - _writer_pos; }
+  [[nodiscard]] auto writeableBytes() const { return _capacity - _writer_pos; }
 
   [[nodiscard]] auto readableBytes() const { return _writer_pos - _reader_pos; }
 
-  auto writeBegin() { return _buffer.data() + _writer_pos; }
+  [[nodiscard]] auto prependableBytes() const { return _reader_pos; }
 
-  auto writeEnd() { return _buffer.data() + _buffer.size(); }
+  [[nodiscard]] auto prependSize() const { return _prepend_size; }
 
-  auto readBegin() { return _buffer.data() + _reader_pos; }
+  auto writeBegin() { return _buffer + _writer_pos; }
 
-  auto readEnd() { return _buffer.data() + _writer_pos; }
+  auto writeEnd() { return _buffer + _capacity; }
 
-  [[nodiscard]] auto readBegin() const { return _buffer.data() + _reader_pos; }
+  auto readBegin() { return _buffer + _reader_pos; }
 
-  [[nodiscard]] auto readEnd() const { return _buffer.data() + _writer_pos; }
+  auto readEnd() { return _buffer + _writer_pos; }
+
+  [[nodiscard]] auto readBegin() const -> const char* {
+    return _buffer + _reader_pos;
+  }
+
+  [[nodiscard]] auto readEnd() const -> const char* {
+    return _buffer + _writer_pos;
+  }
+
+  // Offsets are relative to readBegin(). After a miss, resume from
+  // readableBytes(), or readableBytes() - 1 for CRLF (a lone '\r').
+  [[nodiscard]] auto findCRLF(std::size_t start = 0) const -> std::size_t {
+    return toOffset(common::findCRLF(searchBegin(start), readEnd()));
+  }
+
+  [[nodiscard]] auto findEOL(std::size_t start = 0) const -> std::size_t {
+    return findByte('\n', start);
+  }
+
+  [[nodiscard]] auto findByte(char c, std::size_t start = 0) const
+      -> std::size_t {
+    return toOffset(common::findByte(searchBegin(start), readEnd(), c));
+  }
+
+  [[nodiscard]] auto findAnyOf(std::string_view set,
+                               std::size_t start = 0) const -> std::size_t {
+    return toOffset(common::findAnyOf(searchBegin(start), readEnd(), set));
+  }
 
   auto hasWritten(std::size_t len) {
     _writer_pos += len;
     return _writer_pos;
   }
 
-  auto append(const char* data, std::size_t len) {
-    if (writeableBytes() < len) {
-      auto new_size = std::max(_buffer.size() * 2, _buffer.size() + len);
-      _buffer.resize(new_size);
+  // Make room for len bytes: move the readable bytes to the front if that
+  // is enough, else carry only them over into a bigger chunk.
+  auto ensureWritableBytes(std::size_t len) -> void {
+    if (len <= writeableBytes()) {
+      return;
+    }
+
+    auto readable = readableBytes();
+    if (_buffer != nullptr && _prepend_size + readable + len <= _capacity) {
+      std::memmove(_buffer + _prepend_size, readBegin(), readable);
+      _reader_pos = _prepend_size;
+      _writer_pos = _reader_pos + readable;
+      return;
     }
 
+    auto new_size = std::max(
+        {_capacity * 2, _prepend_size + readable + len, DEFAULT_SIZE});
+    reallocate(new_size, _prepend_size);
+  }
+
+  auto append(const char* data, std::size_t len) {
+    ensureWritableBytes(len);
     std::copy(data, data + len, writeBegin());
     _writer_pos += len;
   }
@@ -54,6 +161,33 @@ class Buffer {
 
   auto append(char data) { append(&data, 1); }
 
+  // Put len bytes in front of the readable bytes, which are only copied if
+  // the prepend area is too small.
+  auto prepend(const char* data, std::size_t len) {
+    if (prependableBytes() < len) {
+      reallocate(std::max(_capacity, len + readableBytes()), len);
+    }
+
+    _reader_pos -= len;
+    std::copy(data, data + len, readBegin());
+  }
+
+  auto prepend(std::string_view data) { prepend(data.data(), data.size()); }
+
+  auto prependInt8(std::int8_t value) { prependIntBE(value); }
+
+  auto prependInt16BE(std::int16_t value) { prependIntBE(value); }
+
+  auto prependInt32BE(std::int32_t value) { prependIntBE(value); }
+
+  auto prependInt64BE(std::int64_t value) { prependIntBE(value); }
+
+  auto prependInt16LE(std::int16_t value) { prependIntLE(value); }
+
+  auto prependInt32LE(std::int32_t value) { prependIntLE(value); }
+
+  auto prependInt64LE(std::int64_t value) { prependIntLE(value); }
+
   auto retrieve(std::size_t len) {
     if (readableBytes() <= len) {
       retrieveAll();
@@ -77,27 +211,81 @@ class Buffer {
   auto resize(std::size_t len) -> void {
     if (empty()) {
       retrieveAll();
-      _buffer.resize(len);
+      if (_capacity != BufferPool::chunkSize(_prepend_size + len)) {
+        reallocate(_prepend_size + len, _prepend_size);
+      }
       return;
     }
 
-    if (len <= writeableBytes()) {
-      return;
-    }
+    ensureWritableBytes(len);
+  }
 
-    _buffer.resize(_buffer.size() + len);
+  // Drop the contents and give the storage back to the pool. The next write
+  // allocates again.
+  auto release() -> void {
+    BufferPool::deallocate(_buffer, _capacity);
+    _buffer = nullptr;
+    _capacity = 0;
+    retrieveAll();
   }
 
  private:
   auto retrieveAll() -> void {
-    _reader_pos = 0;
-    _writer_pos = 0;
+    _reader_pos = _buffer == nullptr ? 0 : _prepend_size;
+    _writer_pos = _reader_pos;
+  }
+
+  [[nodiscard]] auto searchBegin(std::size_t start) const -> const char* {
+    return readBegin() + std::min(start, readableBytes());
+  }
+
+  [[nodiscard]] auto toOffset(const char* p) const -> std::size_t {
+    return p == readEnd() ? npos : static_cast<std::size_t>(p - readBegin());
+  }
+
+  template <typename T>
+  auto prependIntBE(T value) -> void {
+    char bytes[sizeof(T)];
+    auto u = static_cast<std::make_unsigned_t<T>>(value);
+    for (auto i = sizeof(T); 0 < i; --i) {
+      bytes[i - 1] = static_cast<char>(u & 0xff);
+      u >>= 8;
+    }
+    prepend(bytes, sizeof(T));
+  }
+
+  template <typename T>
+  auto prependIntLE(T value) -> void {
+    char bytes[sizeof(T)];
+    auto u = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      bytes[i] = static_cast<char>(u & 0xff);
+      u >>= 8;
+    }
+    prepend(bytes, sizeof(T));
+  }
+
+  // Move the readable bytes into a new chunk of at least len bytes, with
+  // prepend bytes free in front of them.
+  auto reallocate(std::size_t len, std::size_t prepend) -> void {
+    auto readable = readableBytes();
+    auto* buffer = BufferPool::allocate(len);
+    if (readable != 0) {
+      std::copy(readBegin(), readEnd(), buffer + prepend);
+    }
+    BufferPool::deallocate(_buffer, _capacity);
+    _buffer = buffer;
+    _capacity = BufferPool::chunkSize(len);
+    _reader_pos = prepend;
+    _writer_pos = prepend + readable;
   }
 
  private:
   std::size_t _writer_pos{};
   std::size_t _reader_pos{};
-  std::vector<char> _buffer = std::vector<char>(DEFAULT_SIZE, 0);
+  std::size_t _capacity{};
+  std::size_t _prepend_size{CHEAP_PREPEND};
+  char* _buffer{};
 };
 
 }  // namespace fz::net
@@ -0,0 +1,166 @@
+#ifndef __FZ_NET_BUFFER_POOL_H__
+#define __FZ_NET_BUFFER_POOL_H__
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "fz/net/common/relaxed_counter.h"
+
+namespace fz::net {
+
+// Size-classed cache of heap chunks, installed by each Loop as its thread's
+// pool, so it never locks. A chunk freed elsewhere lands in that thread's.
+class BufferPool {
+ public:
+  constexpr static std::size_t MIN_CHUNK_SIZE = 512;
+
+  constexpr static std::size_t MAX_CHUNK_SIZE = 64 * 1024;
+
+  constexpr static std::size_t SIZE_CLASSES =
+      std::bit_width(MAX_CHUNK_SIZE / MIN_CHUNK_SIZE);
+
+  constexpr static std::size_t MAX_CACHED_BYTES_PER_CLASS = 1024 * 1024;
+
+  struct Stats {
+    std::uint64_t hits{};
+    std::uint64_t misses{};
+    std::uint64_t acquired_bytes{};
+    std::uint64_t released_bytes{};
+    std::uint64_t cached_bytes{};
+
+    [[nodiscard]] auto hitRate() const {
+      auto total = hits + misses;
+      return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+    }
+
+    // Chunks may be released on another thread than the one they were
+    // acquired on, so a single pool can observe a negative value.
+    [[nodiscard]] auto outstandingBytes() const {
+      return static_cast<std::int64_t>(acquired_bytes) -
+             static_cast<std::int64_t>(released_bytes);
+    }
+  };
+
+ public:
+  BufferPool() = default;
+
+  BufferPool(const BufferPool&) = delete;
+
+  BufferPool(BufferPool&&) noexcept = delete;
+
+  auto operator=(const BufferPool&) -> BufferPool& = delete;
+
+  auto operator=(BufferPool&&) noexcept -> BufferPool& = delete;
+
+  ~BufferPool() {
+    for (auto& chunks : _free_chunks) {
+      for (auto* chunk : chunks) {
+        ::operator delete(chunk);
+      }
+    }
+  }
+
+  static auto local() -> BufferPool*& {
+    thread_local BufferPool* pool = nullptr;
+    return pool;
+  }
+
+  static auto setLocal(BufferPool* pool) { local() = pool; }
+
+  constexpr static auto chunkSize(std::size_t len) -> std::size_t {
+    if (len <= MIN_CHUNK_SIZE) {
+      return MIN_CHUNK_SIZE;
+    }
+
+    if (MAX_CHUNK_SIZE < len) {
+      return len;
+    }
+
+    return std::bit_ceil(len);
+  }
+
+  // At least len bytes from the calling thread's pool; the real capacity is
+  // chunkSize(len).
+  static auto allocate(std::size_t len) -> char* {
+    if (auto* pool = local(); pool != nullptr) {
+      return pool->acquire(len);
+    }
+
+    return static_cast<char*>(::operator new(chunkSize(len)));
+  }
+
+  // Give back a chunk obtained from allocate(len).
+  static auto deallocate(char* chunk, std::size_t len) -> void {
+    if (chunk == nullptr) {
+      return;
+    }
+
+    if (auto* pool = local(); pool != nullptr) {
+      pool->recycle(chunk, len);
+      return;
+    }
+
+    ::operator delete(chunk);
+  }
+
+  auto acquire(std::size_t len) -> char* {
+    auto size = chunkSize(len);
+    bumpCounter(_acquired_bytes, size);
+    if (size <= MAX_CHUNK_SIZE) {
+      auto& chunks = _free_chunks[sizeClass(size)];
+      if (!chunks.empty()) {
+        auto* chunk = chunks.back();
+        chunks.pop_back();
+        bumpCounter(_hits, 1);
+        dropCounter(_cached_bytes, size);
+        return chunk;
+      }
+    }
+
+    bumpCounter(_misses, 1);
+    return static_cast<char*>(::operator new(size));
+  }
+
+  auto recycle(char* chunk, std::size_t len) -> void {
+    auto size = chunkSize(len);
+    bumpCounter(_released_bytes, size);
+    if (size <= MAX_CHUNK_SIZE) {
+      auto& chunks = _free_chunks[sizeClass(size)];
+      if ((chunks.size() + 1) * size <= MAX_CACHED_BYTES_PER_CLASS) {
+        chunks.push_back(chunk);
+        bumpCounter(_cached_bytes, size);
+        return;
+      }
+    }
+
+    ::operator delete(chunk);
+  }
+
+  [[nodiscard]] auto stats() const -> Stats {
+    constexpr auto o = std::memory_order_relaxed;
+    return {_hits.load(o), _misses.load(o), _acquired_bytes.load(o),
+            _released_bytes.load(o), _cached_bytes.load(o)};
+  }
+
+ private:
+  constexpr static auto sizeClass(std::size_t size) -> std::size_t {
+    return std::bit_width(size / MIN_CHUNK_SIZE) - 1;
+  }
+
+ private:
+  std::array<std::vector<char*>, SIZE_CLASSES> _free_chunks;
+  std::atomic<std::uint64_t> _hits{};
+  std::atomic<std::uint64_t> _misses{};
+  std::atomic<std::uint64_t> _acquired_bytes{};
+  std::atomic<std::uint64_t> _released_bytes{};
+  std::atomic<std::uint64_t> _cached_bytes{};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_BUFFER_POOL_H__
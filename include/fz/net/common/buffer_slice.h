@@ -0,0 +1,67 @@
+#ifndef __FZ_NET_BUFFER_SLICE_H__
+#define __FZ_NET_BUFFER_SLICE_H__
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "fz/net/common/buffer.h"
+
+namespace fz::net {
+
+// Immutable, reference counted view of readable bytes: one payload can be
+// queued on many sessions without a copy in user space.
+class BufferSlice {
+ public:
+  BufferSlice() = default;
+
+  explicit BufferSlice(Buffer&& buffer)
+      : _buffer{std::make_shared<const Buffer>(std::move(buffer))},
+        _data{_buffer->readBegin()},
+        _size{_buffer->readableBytes()} {}
+
+  explicit BufferSlice(std::string_view data)
+      : BufferSlice{fromString(data)} {}
+
+  [[nodiscard]] auto data() const { return _data; }
+
+  [[nodiscard]] auto size() const { return _size; }
+
+  [[nodiscard]] auto empty() const { return _size == 0; }
+
+  [[nodiscard]] auto view() const { return std::string_view{_data, _size}; }
+
+  [[nodiscard]] auto useCount() const { return _buffer.use_count(); }
+
+  [[nodiscard]] auto slice(std::size_t offset, std::size_t len) const {
+    assert(offset + len <= _size);
+    auto s = *this;
+    s._data += offset;
+    s._size = len;
+    return s;
+  }
+
+  auto removePrefix(std::size_t len) {
+    assert(len <= _size);
+    _data += len;
+    _size -= len;
+  }
+
+ private:
+  static auto fromString(std::string_view data) -> BufferSlice {
+    auto buffer = Buffer{};
+    buffer.append(data);
+    return BufferSlice{std::move(buffer)};
+  }
+
+ private:
+  std::shared_ptr<const Buffer> _buffer;
+  const char* _data{};
+  std::size_t _size{};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_BUFFER_SLICE_H__
@@ -0,0 +1,40 @@
+#ifndef __FZ_NET_CYCLE_CLOCK_H__
+#define __FZ_NET_CYCLE_CLOCK_H__
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace fz::net {
+
+// Cheapest monotonic timestamp for short intervals: the TSC on x86, else
+// steady_clock. calibrate() early to keep the rate measurement off hot paths.
+class CycleClock {
+ public:
+  static auto now() -> std::uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  static auto toNanos(std::uint64_t ticks) -> std::uint64_t {
+    return static_cast<std::uint64_t>(static_cast<double>(ticks) *
+                                      nanosPerTick());
+  }
+
+  static auto calibrate() -> void { nanosPerTick(); }
+
+ private:
+  static auto nanosPerTick() -> double;
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_CYCLE_CLOCK_H__
@@ -0,0 +1,73 @@
+#ifndef __FZ_NET_COMMON_FILE_REGION_H__
+#define __FZ_NET_COMMON_FILE_REGION_H__
+
+#include <asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace fz::net {
+
+// Byte range of a regular file queued for sending with sendfile(2), or mmap
+// and write. Holds its own dup of the fd, so the caller may close theirs.
+class FileRegion {
+ public:
+  // Upper bound of one sendfile/write call, so one big file does not keep
+  // the loop busy.
+  constexpr static std::size_t MAX_TRANSFER_BYTES = 1024 * 1024;
+
+ public:
+  FileRegion(int fd, std::uint64_t offset, std::size_t length);
+
+  FileRegion(const FileRegion&) = delete;
+
+  FileRegion(FileRegion&& other) noexcept
+      : _fd{std::exchange(other._fd, -1)},
+        _offset{other._offset},
+        _size{std::exchange(other._size, 0)},
+        _use_mmap{other._use_mmap} {}
+
+  auto operator=(const FileRegion&) -> FileRegion& = delete;
+
+  auto operator=(FileRegion&& other) noexcept -> FileRegion& {
+    auto moved = FileRegion{std::move(other)};
+    std::swap(_fd, moved._fd);
+    std::swap(_offset, moved._offset);
+    std::swap(_size, moved._size);
+    std::swap(_use_mmap, moved._use_mmap);
+    return *this;
+  }
+
+  ~FileRegion();
+
+  [[nodiscard]] auto valid() const { return 0 <= _fd; }
+
+  [[nodiscard]] auto fd() const { return _fd; }
+
+  [[nodiscard]] auto offset() const { return _offset; }
+
+  [[nodiscard]] auto size() const { return _size; }
+
+  [[nodiscard]] auto empty() const { return _size == 0; }
+
+  // Write the next part to a non-blocking socket. Returns the bytes written;
+  // ec is would_block when the socket buffer is full.
+  auto sendTo(int socket, asio::error_code& ec) -> std::size_t;
+
+ private:
+  auto sendfileTo(int socket, std::size_t len, asio::error_code& ec)
+      -> std::size_t;
+
+  auto mmapTo(int socket, std::size_t len, asio::error_code& ec)
+      -> std::size_t;
+
+ private:
+  int _fd{-1};
+  std::uint64_t _offset{};
+  std::size_t _size{};
+  bool _use_mmap{false};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_COMMON_FILE_REGION_H__
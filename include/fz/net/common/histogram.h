@@ -0,0 +1,81 @@
+#ifndef __FZ_NET_HISTOGRAM_H__
+#define __FZ_NET_HISTOGRAM_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "fz/net/common/relaxed_counter.h"
+
+namespace fz::net {
+
+// Durations in nanoseconds, bucket i holding [2^(i-1), 2^i). record() on one
+// thread only; snapshot() from any, possibly mid-record.
+class Histogram {
+ public:
+  constexpr static std::size_t BUCKETS = 64;
+
+  struct Snapshot {
+    std::array<std::uint64_t, BUCKETS> buckets{};
+    std::uint64_t count{};
+    std::uint64_t sum{};
+    std::uint64_t max{};
+
+    [[nodiscard]] auto mean() const -> double {
+      return count == 0 ? 0.0
+                        : static_cast<double>(sum) / static_cast<double>(count);
+    }
+
+    // Upper bound of the bucket holding quantile q, 0 <= q <= 1.
+    [[nodiscard]] auto percentile(double q) const -> std::uint64_t {
+      auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+      std::uint64_t seen = 0;
+      for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (rank < seen) {
+          return std::min(upperBound(i), max);
+        }
+      }
+      return max;
+    }
+
+    static auto upperBound(std::size_t bucket) -> std::uint64_t {
+      return bucket == 0 ? 0 : (std::uint64_t{1} << bucket) - 1;
+    }
+  };
+
+ public:
+  auto record(std::uint64_t nanos) -> void {
+    auto bucket = std::min<std::size_t>(std::bit_width(nanos), BUCKETS - 1);
+    bumpCounter(_buckets[bucket], 1);
+    bumpCounter(_count, 1);
+    bumpCounter(_sum, nanos);
+    if (_max.load(std::memory_order_relaxed) < nanos) {
+      _max.store(nanos, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] auto snapshot() const -> Snapshot {
+    auto s = Snapshot{};
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+      s.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+    s.count = _count.load(std::memory_order_relaxed);
+    s.sum = _sum.load(std::memory_order_relaxed);
+    s.max = _max.load(std::memory_order_relaxed);
+    return s;
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, BUCKETS> _buckets{};
+  std::atomic<std::uint64_t> _count{};
+  std::atomic<std::uint64_t> _sum{};
+  std::atomic<std::uint64_t> _max{};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_HISTOGRAM_H__
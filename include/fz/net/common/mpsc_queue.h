@@ -0,0 +1,91 @@
+#ifndef __FZ_NET_COMMON_MPSC_QUEUE_H__
+#define __FZ_NET_COMMON_MPSC_QUEUE_H__
+
+#include <atomic>
+#include <type_traits>
+
+namespace fz::net {
+
+// Hook for types stored in an MpscQueue.
+class MpscNode {
+ private:
+  template <typename T>
+    requires std::is_base_of_v<MpscNode, T>
+  friend class MpscQueue;
+
+  std::atomic<MpscNode*> _mpsc_next{nullptr};
+};
+
+// Intrusive Vyukov MPSC queue that does not own its nodes. pop() may return
+// nullptr during an in-flight push, which empty() reports as non-empty.
+template <typename T>
+  requires std::is_base_of_v<MpscNode, T>
+class MpscQueue {
+ public:
+  MpscQueue() = default;
+
+  MpscQueue(const MpscQueue&) = delete;
+
+  MpscQueue(MpscQueue&&) noexcept = delete;
+
+  auto operator=(const MpscQueue&) -> MpscQueue& = delete;
+
+  auto operator=(MpscQueue&&) noexcept -> MpscQueue& = delete;
+
+  ~MpscQueue() = default;
+
+  auto push(T* node) -> void { pushNode(node); }
+
+  auto pop() -> T* {
+    auto* tail = _tail;
+    auto* next = tail->_mpsc_next.load(std::memory_order_acquire);
+    if (tail == &_stub) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+
+      _tail = next;
+      tail = next;
+      next = next->_mpsc_next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+      _tail = next;
+      return static_cast<T*>(tail);
+    }
+
+    if (tail != _head.load(std::memory_order_acquire)) {
+      return nullptr;  // a producer has not linked its node yet
+    }
+
+    // tail is the last node: put the stub behind it so it can be unlinked.
+    pushNode(&_stub);
+    next = tail->_mpsc_next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      _tail = next;
+      return static_cast<T*>(tail);
+    }
+
+    return nullptr;
+  }
+
+  [[nodiscard]] auto empty() const -> bool {
+    return _tail == &_stub && _head.load(std::memory_order_acquire) == &_stub;
+  }
+
+ private:
+  auto pushNode(MpscNode* node) -> void {
+    node->_mpsc_next.store(nullptr, std::memory_order_relaxed);
+    auto* prev = _head.exchange(node, std::memory_order_acq_rel);
+    prev->_mpsc_next.store(node, std::memory_order_release);
+  }
+
+ private:
+  MpscNode _stub;
+  std::atomic<MpscNode*> _head{&_stub};  // producers
+  MpscNode* _tail{&_stub};               // consumer
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_COMMON_MPSC_QUEUE_H__
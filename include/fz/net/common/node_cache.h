@@ -0,0 +1,81 @@
+#ifndef __FZ_NET_COMMON_NODE_CACHE_H__
+#define __FZ_NET_COMMON_NODE_CACHE_H__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace fz::net {
+
+// Lock-free thread-local freelist for intrusive queue nodes. Nodes stay in
+// the cache of the thread that recycles them, i.e. the consuming loop.
+template <typename T>
+class NodeCache {
+ public:
+  constexpr static std::size_t MAX_CACHED_NODES = 1024;
+
+  template <typename... Args>
+  static auto make(Args&&... args) -> T* {
+    auto& nodes = local()._nodes;
+    void* memory = nullptr;
+    if (nodes.empty()) {
+      memory = ::operator new(sizeof(T));
+    } else {
+      memory = nodes.back();
+      nodes.pop_back();
+    }
+
+    try {
+      return new (memory) T(std::forward<Args>(args)...);
+    } catch (...) {
+      give(memory);
+      throw;
+    }
+  }
+
+  static auto recycle(T* node) -> void {
+    if (node == nullptr) {
+      return;
+    }
+
+    node->~T();
+    give(node);
+  }
+
+ private:
+  struct Cache {
+    Cache() { _nodes.reserve(MAX_CACHED_NODES); }
+
+    Cache(const Cache&) = delete;
+
+    auto operator=(const Cache&) -> Cache& = delete;
+
+    ~Cache() {
+      for (auto* memory : _nodes) {
+        ::operator delete(memory);
+      }
+    }
+
+    std::vector<void*> _nodes;
+  };
+
+  static auto local() -> Cache& {
+    thread_local Cache cache;
+    return cache;
+  }
+
+  static auto give(void* memory) -> void {
+    auto& nodes = local()._nodes;
+    if (nodes.size() < MAX_CACHED_NODES) {
+      nodes.push_back(memory);
+      return;
+    }
+
+    ::operator delete(memory);
+  }
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_COMMON_NODE_CACHE_H__
@@ -0,0 +1,26 @@
+#ifndef __FZ_NET_COMMON_RELAXED_COUNTER_H__
+#define __FZ_NET_COMMON_RELAXED_COUNTER_H__
+
+#include <atomic>
+#include <cstdint>
+
+namespace fz::net {
+
+// Counters with a single writer that any thread may read. A plain relaxed
+// load/store pair is enough and avoids a locked read-modify-write on the
+// hot path; with more than one writer, updates would be lost.
+inline auto bumpCounter(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    -> void {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline auto dropCounter(std::atomic<std::uint64_t>& counter, std::uint64_t n)
+    -> void {
+  counter.store(counter.load(std::memory_order_relaxed) - n,
+                std::memory_order_relaxed);
+}
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_COMMON_RELAXED_COUNTER_H__
@@ -0,0 +1,22 @@
+#ifndef __FZ_NET_COMMON_SEARCH_H__
+#define __FZ_NET_COMMON_SEARCH_H__
+
+#include <string_view>
+
+namespace fz::net::common {
+
+// Delimiter search over [begin, end) with AVX2, SSE2 or scalar code picked
+// at startup from the CPU. Every function returns end when nothing is found.
+auto findByte(const char* begin, const char* end, char c) -> const char*;
+
+auto findCRLF(const char* begin, const char* end) -> const char*;
+
+auto findAnyOf(const char* begin, const char* end, std::string_view set)
+    -> const char*;
+
+// Name of the selected implementation, for diagnostics.
+auto searchImplName() -> std::string_view;
+
+}  // namespace fz::net::common
+
+#endif  // __FZ_NET_COMMON_SEARCH_H__
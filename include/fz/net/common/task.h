@@ -0,0 +1,115 @@
+#ifndef __FZ_NET_COMMON_TASK_H__
+#define __FZ_NET_COMMON_TASK_H__
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace fz::net {
+
+// Move-only void() callable. Nothrow-movable callables of up to INLINE_SIZE
+// bytes are stored inline, larger ones on the heap.
+class Task {
+ public:
+  constexpr static std::size_t INLINE_SIZE = 48;
+
+ public:
+  Task() = default;
+
+  template <typename F>
+    requires(!std::same_as<std::decay_t<F>, Task> &&
+             std::invocable<std::decay_t<F>&>)
+  Task(F&& func) {
+    using Func = std::decay_t<F>;
+    if constexpr (fitsInline<Func>()) {
+      ::new (static_cast<void*>(_storage)) Func(std::forward<F>(func));
+      _ops = &INLINE_OPS<Func>;
+    } else {
+      auto* heap = new Func(std::forward<F>(func));
+      ::new (static_cast<void*>(_storage)) Func*(heap);
+      _ops = &HEAP_OPS<Func>;
+    }
+  }
+
+  Task(const Task&) = delete;
+
+  auto operator=(const Task&) -> Task& = delete;
+
+  Task(Task&& other) noexcept : _ops{other._ops} {
+    if (_ops != nullptr) {
+      _ops->move(_storage, other._storage);
+      other._ops = nullptr;
+    }
+  }
+
+  auto operator=(Task&& other) noexcept -> Task& {
+    if (this != &other) {
+      reset();
+      if (other._ops != nullptr) {
+        other._ops->move(_storage, other._storage);
+        _ops = std::exchange(other._ops, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  ~Task() { reset(); }
+
+  explicit operator bool() const { return _ops != nullptr; }
+
+  auto operator()() -> void { _ops->invoke(_storage); }
+
+  // True if callables of type F are stored without an allocation.
+  template <typename F>
+  constexpr static auto fitsInline() -> bool {
+    return sizeof(F) <= INLINE_SIZE &&
+           alignof(F) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<F>;
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    // Move the callable in src to the empty dst and destroy what is left.
+    void (*move)(void* dst, void* src) noexcept;
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename F>
+  constexpr static Ops INLINE_OPS{
+      [](void* storage) { (*std::launder(static_cast<F*>(storage)))(); },
+      [](void* dst, void* src) noexcept {
+        auto* func = std::launder(static_cast<F*>(src));
+        ::new (dst) F(std::move(*func));
+        func->~F();
+      },
+      [](void* storage) noexcept {
+        std::launder(static_cast<F*>(storage))->~F();
+      }};
+
+  template <typename F>
+  constexpr static Ops HEAP_OPS{
+      [](void* storage) { (**std::launder(static_cast<F**>(storage)))(); },
+      [](void* dst, void* src) noexcept {
+        ::new (dst) F*(*std::launder(static_cast<F**>(src)));
+      },
+      [](void* storage) noexcept {
+        delete *std::launder(static_cast<F**>(storage));
+      }};
+
+  auto reset() -> void {
+    if (_ops != nullptr) {
+      std::exchange(_ops, nullptr)->destroy(_storage);
+    }
+  }
+
+ private:
+  alignas(std::max_align_t) std::byte _storage[INLINE_SIZE];
+  const Ops* _ops{nullptr};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_COMMON_TASK_H__
@@ -1,15 +1,37 @@
 #ifndef __FZ_NET_LOOP_POOL_H__
 #define __FZ_NET_LOOP_POOL_H__
 
+#include <chrono>
+#include <cstddef>
+#include <string>
 #include <vector>
 
 #include "fz/net/loop.h"
 
 namespace fz::net {
 
+// Thread settings of the loops of a LoopPool. See Loop::ThreadOptions.
+struct LoopPoolOptions {
+  std::string name{"fz-loop"};  // threads are named <name>-<index>
+  // Loop i runs on cpu_sets[i % cpu_sets.size()]; empty for no pinning.
+  // cpuPerLoop() gives every loop a CPU of its own.
+  std::vector<std::vector<int>> cpu_sets;
+  bool numa_local{false};
+  // The default forbids using the loops' sockets from other threads; code
+  // that does must pass ASIO_CONCURRENCY_HINT_DEFAULT.
+  int concurrency_hint{Loop::DEFAULT_CONCURRENCY_HINT};
+  std::size_t inbox_batch_size{Loop::DEFAULT_INBOX_BATCH_SIZE};
+  // See Loop::setBusyPoll(); best with a CPU per loop.
+  std::chrono::microseconds busy_poll{};
+};
+
 class LoopPool {
  public:
-  explicit LoopPool(std::size_t size);
+  explicit LoopPool(std::size_t size, LoopPoolOptions options = {});
+
+  // Loop i on online CPU i, wrapping around when there are fewer CPUs.
+  // Empty where pinning is not supported.
+  static auto cpuPerLoop(std::size_t size) -> std::vector<std::vector<int>>;
 
   auto start() -> void;
 
@@ -17,8 +39,11 @@ class LoopPool {
 
   auto findNext() -> std::shared_ptr<Loop>;
 
+  auto loops() const -> const auto& { return _loops; }
+
  private:
   std::vector<std::shared_ptr<Loop>> _loops;
+  LoopPoolOptions _options;
 };
 
 }  // namespace fz::net
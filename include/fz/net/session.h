@@ -1,25 +1,69 @@
 #ifndef __FZ_NET_SESSION_H__
 #define __FZ_NET_SESSION_H__
 
+#include <array>
 #include <asio.hpp>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
-#include <mutex>
-#include <queue>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <utility>
+#include <variant>
 
+#include "fz/net/codec.h"
 #include "fz/net/common/buffer.h"
+#include "fz/net/common/buffer_slice.h"
+#include "fz/net/common/file_region.h"
+#include "fz/net/common/mpsc_queue.h"
+#include "fz/net/common/node_cache.h"
+#include "fz/net/common/relaxed_counter.h"
 #include "fz/net/loop.h"
+#include "fz/net/session_registry.h"
+#include "fz/net/timing_wheel.h"
 
 namespace fz::net {
 
-class Session : public std::enable_shared_from_this<Session> {
+class Session : public std::enable_shared_from_this<Session>,
+                public MpscNode {
  public:
+  using WriteItem = std::variant<BufferSlice, FileRegion>;
+
+  // Sessions of one server share one immutable instance; setting a callback
+  // on a single session gives it a private copy.
+  struct Callbacks {
+    std::function<void(std::shared_ptr<Session>)> connect;
+    std::function<void(std::shared_ptr<Session>, Buffer&)> read;
+    std::function<void(std::shared_ptr<Session>)> disconnect;
+    std::function<void(std::shared_ptr<Session>, std::size_t)> high_water_mark;
+    std::function<void(std::shared_ptr<Session>)> write_complete;
+    std::function<void(std::shared_ptr<Session>, std::string_view)> message;
+  };
+
+  using IoVecs = std::array<asio::const_buffer, 64>;
+
+  using Coroutine =
+      std::function<asio::awaitable<void>(std::shared_ptr<Session>)>;
+
   constexpr static auto DEFAULT_RECONNECT_TIMES = 3;
 
   constexpr static auto DEFAULT_RECONNECT_DELAY_MS = 500;
 
+  // Upper bounds of one scatter-gather write. asio hands at most 64 buffers
+  // to a single writev/sendmsg anyway.
+  constexpr static std::size_t MAX_WRITE_IOVECS = std::tuple_size_v<IoVecs>;
+
+  constexpr static std::size_t MAX_WRITE_BYTES = 256 * 1024;
+
+  constexpr static std::size_t DEFAULT_HIGH_WATER_MARK = 64 * 1024 * 1024;
+
+  constexpr static std::size_t MAX_READ_UNTIL_BYTES = 1024 * 1024;
+
  public:
   Session(const Session&) = delete;
 
@@ -33,33 +77,139 @@ class Session : public std::enable_shared_from_this<Session> {
       : _loop{std::move(loop)},
         _socket{_loop->getIoContext()},
         _timer{_loop->getIoContext()},
-        _id{reinterpret_cast<std::uint64_t>(this)} {}
+        _id{_loop->nextSessionId()} {}
+
+  virtual ~Session();
 
-  virtual ~Session() = default;
+  // Back to the freshly constructed state for reuse by a SessionPool.
+  // Overrides with per-connection state must call Session::reset().
+  virtual auto reset() -> void;
 
   auto socket() -> auto& { return _socket; }
 
   auto socket() const -> auto& { return _socket; }
 
+  // The socket is only used on this loop's thread.
+  auto loop() const -> const std::shared_ptr<Loop>& { return _loop; }
+
   auto start() -> void;
 
+  // Run coroutine on the session's loop instead of the callback read loop.
+  // The session is closed once the coroutine returns and releases it.
+  auto spawn(const Coroutine& coroutine) -> void;
+
   auto disconnect() -> void;
 
   auto send(const Buffer& buffer) -> void;
 
+  auto send(Buffer&& buffer) -> void;
+
+  auto send(BufferSlice slice) -> void;
+
+  // send() for code on the session's loop outside its handlers, such as a
+  // batch task: the write starts at once instead of in a task of its own.
+  auto sendInLoop(BufferSlice slice) -> void;
+
+  // Queue [offset, offset + length) of fd, sent in order with sendfile(2).
+  // fd is duplicated and may be closed once this returns.
+  auto sendFile(int fd, std::uint64_t offset, std::size_t length) -> void;
+
+  // Frame message with the session's codec and send it; sent as is without
+  // a codec.
+  auto sendMessage(std::string_view message) -> void;
+
+  // Coroutine API, for sessions started with spawn(). Call these from the
+  // coroutine on the session's loop only. write() goes straight to the
+  // socket, so do not mix it with send() on one session. Errors, including
+  // eof, are reported through ec.
+
+  // Wait for data and append what is available to buffer. Returns the
+  // number of bytes read.
+  auto read(Buffer& buffer, asio::error_code& ec)
+      -> asio::awaitable<std::size_t>;
+
+  // Returns the length up to and including delim; fails with message_size
+  // once max_size bytes are buffered without one.
+  auto readUntil(Buffer& buffer, std::string_view delim, asio::error_code& ec,
+                 std::size_t max_size = MAX_READ_UNTIL_BYTES)
+      -> asio::awaitable<std::size_t>;
+
+  // Write all of slice. Returns the number of bytes written.
+  auto write(BufferSlice slice, asio::error_code& ec)
+      -> asio::awaitable<std::size_t>;
+
+  auto setCallbacks(std::shared_ptr<const Callbacks> callbacks) {
+    _callbacks = std::move(callbacks);
+  }
+
   auto setConnectCallback(
       std::function<void(std::shared_ptr<Session>)> callback) {
-    _connect_callback = std::move(callback);
+    mutableCallbacks().connect = std::move(callback);
   }
 
   auto setReadCallback(
       std::function<void(std::shared_ptr<Session>, Buffer&)> callback) {
-    _read_callback = std::move(callback);
+    mutableCallbacks().read = std::move(callback);
   }
 
   auto setDisconnectCallback(
       std::function<void(std::shared_ptr<Session>)> callback) {
-    _disconnect_callback = std::move(callback);
+    mutableCallbacks().disconnect = std::move(callback);
+  }
+
+  // Called on the loop thread once queued bytes reach high_water_mark, and
+  // not again until they drain to the low water mark (half of it here).
+  auto setHighWaterMarkCallback(
+      std::function<void(std::shared_ptr<Session>, std::size_t)> callback,
+      std::size_t high_water_mark = DEFAULT_HIGH_WATER_MARK) {
+    mutableCallbacks().high_water_mark = std::move(callback);
+    setHighWaterMark(high_water_mark);
+  }
+
+  // Also sets the low water mark to half of high_water_mark.
+  auto setHighWaterMark(std::size_t high_water_mark) -> void {
+    _high_water_mark.store(high_water_mark, std::memory_order_relaxed);
+    _low_water_mark.store(high_water_mark / 2, std::memory_order_relaxed);
+  }
+
+  auto setLowWaterMark(std::size_t low_water_mark) {
+    _low_water_mark.store(low_water_mark, std::memory_order_relaxed);
+  }
+
+  // Called on the loop thread each time everything queued so far has been
+  // handed to the kernel.
+  auto setWriteCompleteCallback(
+      std::function<void(std::shared_ptr<Session>)> callback) {
+    mutableCallbacks().write_complete = std::move(callback);
+  }
+
+  // Deliver complete codec messages to the message callback instead of the
+  // read callback. Views are valid in the callback only; bad streams close.
+  auto setCodec(std::shared_ptr<const Codec> codec) {
+    _codec = std::move(codec);
+  }
+
+  auto setMessageCallback(
+      std::function<void(std::shared_ptr<Session>, std::string_view)>
+          callback) {
+    mutableCallbacks().message = std::move(callback);
+  }
+
+  // Pause reading upstream while this session is above its high water mark,
+  // until it drains to the low one. For proxies forwarding upstream here.
+  auto setUpstream(std::weak_ptr<Session> upstream) {
+    _upstream = std::move(upstream);
+  }
+
+  // Stop waiting for data until resumeRead(); a read in flight completes.
+  // Both may be called from any thread.
+  auto pauseRead() -> void;
+
+  auto resumeRead() -> void;
+
+  // Bytes queued but not yet written. Can be read from any thread.
+  auto pendingBytes() const {
+    return _pending_bytes.load(std::memory_order_relaxed);
   }
 
   // Following functions are unsafe in multi-threading environment
@@ -79,42 +229,162 @@ class Session : public std::enable_shared_from_this<Session> {
     _reconnect_delay_ms = reconnect_delay_ms;
   }
 
+  auto sharedReadBuffer() const { return _shared_read_buffer; }
+
+  // Receive into the loop's shared buffer. A private one is only held while
+  // the read callback leaves bytes unconsumed, so idle sessions hold none.
+  auto setSharedReadBuffer(bool shared) { _shared_read_buffer = shared; }
+
+  auto idleTimeout() const { return _idle_timeout; }
+
+  // Disconnect after timeout without data, rounded up to the loop's wheel
+  // tick; zero turns it off. Takes effect when the session starts.
+  auto setIdleTimeout(std::chrono::milliseconds timeout) {
+    _idle_timeout = timeout;
+  }
+
+  auto socketBusyPoll() const { return _socket_busy_poll; }
+
+  // SO_BUSY_POLL for the socket from start; zero keeps the system default.
+  // Above net.core.busy_read it needs CAP_NET_ADMIN; failures are logged.
+  auto setSocketBusyPoll(std::chrono::microseconds timeout) {
+    _socket_busy_poll = timeout;
+  }
+
+  // Be listed in registry from start until disconnect or, for a spawned
+  // session, until its coroutine returns. The registry owns its sessions,
+  // so the session only keeps a weak reference back.
+  auto setRegistry(const std::shared_ptr<SessionRegistry>& registry) {
+    _registry = registry;
+  }
+
   auto connect(const std::string& ip, std::uint16_t port, bool reconnect)
       -> void;
 
   auto reconnect(const std::string& ip, std::uint16_t port) -> void;
 
-  // Debug info
+  // Unique for every connection, also for a session reused from a pool.
+  // Names the session's loop, see Loop::nextSessionId().
   auto id() const { return _id; }
 
+  // Debug info
+
   auto remoteIp() const { return _remote_ip; }
 
   auto remotePort() const { return _remote_port; }
 
+  // Number of write syscalls issued so far. Can be read from any thread.
+  auto writeCalls() const {
+    return _write_calls.load(std::memory_order_relaxed);
+  }
+
  private:
-  auto read() -> void;
+  // Per-connection events. The defaults run the callbacks; BasicSession
+  // overrides them to call its handler directly.
+  virtual auto onConnect() -> void;
+
+  virtual auto onRead(Buffer& buffer) -> void;
+
+  virtual auto onDisconnect() -> void;
+
+  struct WriteNode : MpscNode {
+    explicit WriteNode(WriteItem item) : _item{std::move(item)} {}
+
+    WriteItem _item;
+  };
+
+  auto mutableCallbacks() -> Callbacks&;
+
+  auto doRead() -> void;
+
+  auto open() -> bool;
 
-  auto write() -> void;
+  auto setBusyPollOption() -> void;
+
+  auto readTarget() -> Buffer&;
+
+  auto readSome(Buffer& buffer, asio::error_code& ec) -> std::size_t;
+
+#ifdef ASIO_HAS_IO_URING_AS_DEFAULT
+  // Read into registered buffer index of the loop.
+  auto readRegistered(std::size_t index) -> void;
+#endif
+
+  // Everything after a read completes: errors, the callbacks, the next read.
+  auto finishRead(Buffer& buffer, const asio::error_code& ec, std::size_t len)
+      -> void;
+
+  auto afterRead(Buffer& buffer) -> void;
+
+  auto decodeMessages(Buffer& buffer) -> void;
+
+  // in_loop starts the flush right away instead of posting it.
+  auto enqueue(WriteItem item, bool in_loop = false) -> void;
+
+  auto startIdleTimer() -> void;
+
+  auto stopIdleTimer() -> void;
+
+  auto onIdleTimeout() -> void;
+
+  auto doWrite() -> void;
+
+  auto writeBuffers() -> void;
+
+  auto writeFile(FileRegion& region) -> void;
+
+  auto consumeSent(std::size_t len) -> void;
+
+  auto releasePending(std::size_t len) -> void;
+
+  auto onHighWaterMark() -> void;
+
+  auto countWriteCall() -> void {
+    bumpCounter(_write_calls, 1);
+  }
 
  private:
   std::shared_ptr<Loop> _loop;
-  std::queue<Buffer> _unsent_buffers;
-  std::mutex _mutex;  // for queue
-  Buffer _write_buffer;
-  Buffer _read_buffer;
+  MpscQueue<WriteNode> _unsent_items;    // pushed by any thread
+  std::deque<WriteItem> _sending_items;  // only touched in loop thread
+  std::unique_ptr<IoVecs> _write_iovecs;  // only held while writing
+  // Set by the send that finds the queue idle; cleared by the loop once it
+  // has nothing left to write. Only one flush is scheduled at a time.
+  std::atomic<bool> _write_scheduled{false};
+  bool _writing{false};
+  bool _wrote_since_complete{false};
+  std::atomic<std::size_t> _pending_bytes{};
+  // Set when pending bytes reach the high water mark, cleared when they
+  // drop to the low water mark.
+  std::atomic<bool> _above_high_water_mark{false};
+  // Read by every send, which may run on any thread.
+  std::atomic<std::size_t> _high_water_mark{DEFAULT_HIGH_WATER_MARK};
+  std::atomic<std::size_t> _low_water_mark{DEFAULT_HIGH_WATER_MARK / 2};
+  std::weak_ptr<Session> _upstream;
+  // Set by disconnect() from any thread, cleared when the socket opens
+  // again. Frames still buffered are not delivered once it is set.
+  std::atomic<bool> _disconnecting{false};
+  bool _read_paused{false};   // only touched in loop thread
+  bool _read_stopped{false};  // paused with no wait outstanding
+  Buffer _read_buffer{0};  // nothing is ever prepended to received bytes
+  bool _shared_read_buffer{false};
   asio::ip::tcp::socket _socket;
-  std::function<void(std::shared_ptr<Session>)> _connect_callback;
-  std::function<void(std::shared_ptr<Session>, Buffer&)> _read_callback;
-  std::function<void(std::shared_ptr<Session>)> _disconnect_callback;
+  std::shared_ptr<const Callbacks> _callbacks;
+  std::shared_ptr<const Codec> _codec;
   bool _reconnect{false};
   int _reconnect_times{DEFAULT_RECONNECT_TIMES};
   std::size_t _reconnect_delay_ms{DEFAULT_RECONNECT_DELAY_MS};
   asio::steady_timer _timer;
+  std::chrono::milliseconds _idle_timeout{};
+  std::chrono::microseconds _socket_busy_poll{};
+  TimingWheel::TimerId _idle_timer{nullptr};  // only touched in loop thread
+  std::weak_ptr<SessionRegistry> _registry;
+  std::uint64_t _id;
 
   // Debug info
-  std::uint64_t _id;
   std::string _remote_ip;
   std::uint16_t _remote_port{};
+  std::atomic<std::uint64_t> _write_calls{};
 };
 
 }  // namespace fz::net
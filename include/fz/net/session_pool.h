@@ -0,0 +1,96 @@
+#ifndef __FZ_NET_SESSION_POOL_H__
+#define __FZ_NET_SESSION_POOL_H__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "fz/net/common/mpsc_queue.h"
+#include "fz/net/loop.h"
+#include "fz/net/session.h"
+
+namespace fz::net {
+
+// Recycles the sessions of one loop; must be owned by a std::shared_ptr.
+// acquire() only on the loop's thread; sessions are released on any thread.
+template <typename T>
+  requires std::is_base_of_v<Session, T>
+class SessionPool : public std::enable_shared_from_this<SessionPool<T>> {
+ public:
+  constexpr static std::size_t DEFAULT_MAX_IDLE_SESSIONS = 4096;
+
+ public:
+  explicit SessionPool(std::shared_ptr<Loop> loop,
+                       std::size_t max_idle = DEFAULT_MAX_IDLE_SESSIONS)
+      : _loop{std::move(loop)}, _max_idle{max_idle} {}
+
+  SessionPool(const SessionPool&) = delete;
+
+  SessionPool(SessionPool&&) noexcept = delete;
+
+  auto operator=(const SessionPool&) -> SessionPool& = delete;
+
+  auto operator=(SessionPool&&) noexcept -> SessionPool& = delete;
+
+  ~SessionPool() {
+    while (auto* session = _idle.pop()) {
+      delete static_cast<T*>(session);
+    }
+  }
+
+  [[nodiscard]] auto loop() const -> const auto& { return _loop; }
+
+  [[nodiscard]] auto idleCount() const {
+    return _idle_count.load(std::memory_order_relaxed);
+  }
+
+  auto acquire() -> std::shared_ptr<T> {
+    auto* session = static_cast<T*>(_idle.pop());
+    if (session != nullptr) {
+      _idle_count.fetch_sub(1, std::memory_order_relaxed);
+    } else {
+      session = new T(_loop);
+    }
+
+    return std::shared_ptr<T>(
+        session, [pool = this->weak_from_this()](T* released) {
+          if (auto self = pool.lock()) {
+            self->release(released);
+          } else {
+            delete released;
+          }
+        });
+  }
+
+ private:
+  auto release(T* session) -> void {
+    // reset() closes the socket, which only the loop thread may touch while
+    // the loop runs.
+    if (_loop->isRunning() && !_loop->isInLoopThread()) {
+      _loop->postTask([pool = this->shared_from_this(), session] {
+        pool->release(session);
+      });
+      return;
+    }
+
+    if (_max_idle <= _idle_count.load(std::memory_order_relaxed)) {
+      delete session;
+      return;
+    }
+
+    session->reset();
+    _idle_count.fetch_add(1, std::memory_order_relaxed);
+    _idle.push(session);
+  }
+
+ private:
+  std::shared_ptr<Loop> _loop;
+  std::size_t _max_idle;
+  MpscQueue<Session> _idle;  // released on any thread, acquired on one
+  std::atomic<std::size_t> _idle_count{};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_SESSION_POOL_H__
@@ -0,0 +1,86 @@
+#ifndef __FZ_NET_SESSION_REGISTRY_H__
+#define __FZ_NET_SESSION_REGISTRY_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fz/net/loop.h"
+
+namespace fz::net {
+
+class Session;
+
+// Live sessions of a server, sharded by loop and only touched on the shard's
+// loop thread, so nothing is locked. Visitors run on the session's loop.
+class SessionRegistry {
+ public:
+  using Visitor = std::function<void(const std::shared_ptr<Session>&)>;
+
+ public:
+  explicit SessionRegistry(const std::vector<std::shared_ptr<Loop>>& loops);
+
+  // Called by sessions as they start and close. Both run on the session's
+  // loop, so they stay in order with lookups made from the same thread.
+  auto add(const std::shared_ptr<Session>& session) -> void;
+
+  auto remove(std::uint64_t id) -> void;
+
+  // Call visitor with the session named id, or nullptr if it is not live.
+  // Runs on the session's loop; inline when already there.
+  auto find(std::uint64_t id, Visitor visitor) -> void;
+
+  // Make session findable by key until it is removed or bound to another
+  // key. A key names one session; binding it again moves it.
+  auto bind(const std::shared_ptr<Session>& session, std::string key) -> void;
+
+  auto findByKey(const std::string& key, Visitor visitor) -> void;
+
+  // Visit every live session in one task per shard, always posted. Sessions
+  // added or removed meanwhile may or may not be seen.
+  auto forEach(const Visitor& visitor) -> void;
+
+  // Drop every entry at once. Only while the loops are stopped.
+  auto clear() -> void;
+
+  auto shardCount() const { return _shards.size(); }
+
+  auto size() const -> std::size_t;
+
+  auto size(std::size_t shard) const -> std::size_t {
+    return _shards[shard]->count.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<Session> session;
+    std::string key;
+  };
+
+  struct Shard {
+    std::shared_ptr<Loop> loop;
+    std::unordered_map<std::uint64_t, Entry> sessions;
+    std::unordered_map<std::string, std::uint64_t> keys;
+    std::atomic<std::size_t> count{};
+  };
+
+  auto shardOf(std::uint64_t session_id) const -> Shard*;
+
+  auto keyShardOf(const std::string& key) const -> Shard&;
+
+  auto unbind(const std::string& key, std::uint64_t id) -> void;
+
+ private:
+  std::vector<std::unique_ptr<Shard>> _shards;
+  // Loop id to shard index. Fixed at construction.
+  std::unordered_map<std::uint64_t, std::size_t> _shard_index;
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_SESSION_REGISTRY_H__
@@ -27,11 +27,17 @@ class TcpClient {
   auto session() { return _session; }
 
   auto connect(bool reconnect = true) -> void {
-    _session->connect(_ip, _port, reconnect);
+    _loop->postTask([session = _session, ip = _ip, port = _port, reconnect] {
+      session->connect(ip, port, reconnect);
+    });
   }
 
   auto send(const Buffer& buffer) -> void { _session->send(buffer); }
 
+  auto send(Buffer&& buffer) -> void { _session->send(std::move(buffer)); }
+
+  auto send(BufferSlice slice) -> void { _session->send(std::move(slice)); }
+
   auto disconnect() -> void { _session->disconnect(); }
 
   auto setConnectCallback(
@@ -49,6 +55,28 @@ class TcpClient {
     _session->setDisconnectCallback(std::move(callback));
   }
 
+  auto setHighWaterMarkCallback(
+      std::function<void(std::shared_ptr<Session>, std::size_t)> callback,
+      std::size_t high_water_mark = Session::DEFAULT_HIGH_WATER_MARK)
+      -> void {
+    _session->setHighWaterMarkCallback(std::move(callback), high_water_mark);
+  }
+
+  auto setWriteCompleteCallback(
+      std::function<void(std::shared_ptr<Session>)> callback) -> void {
+    _session->setWriteCompleteCallback(std::move(callback));
+  }
+
+  auto setMessageCallback(
+      std::function<void(std::shared_ptr<Session>, std::string_view)>
+          callback) -> void {
+    _session->setMessageCallback(std::move(callback));
+  }
+
+  auto setCodec(std::shared_ptr<const Codec> codec) -> void {
+    _session->setCodec(std::move(codec));
+  }
+
   auto run() -> void { _loop->start(); }
 
   auto stop() -> void { _loop->stop(); }
@@ -1,63 +1,165 @@
 #ifndef __FZ_NET_TCP_SERVER_H__
 #define __FZ_NET_TCP_SERVER_H__
 
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <string_view>
+#include <unordered_map>
 
 #include "fz/net/acceptor.h"
+#include "fz/net/codec.h"
 #include "fz/net/common/buffer.h"
+#include "fz/net/common/buffer_slice.h"
 #include "fz/net/loop_pool.h"
+#include "fz/net/session.h"
+#include "fz/net/session_pool.h"
+#include "fz/net/session_registry.h"
 
 namespace fz::net {
 
-class Session;
-
 class TcpServer {
  public:
-  TcpServer(std::size_t loop_pool_size, std::string_view ip, uint16_t port);
+  using SessionFilter = std::function<bool(const std::shared_ptr<Session>&)>;
+
+ public:
+  TcpServer(std::size_t loop_pool_size, std::string_view ip, uint16_t port,
+            LoopPoolOptions options = {});
 
   auto start() -> void;
 
   auto stop() -> void;
 
+  // Accept connections into sessions of type T. Closed sessions are reset
+  // and reused for later connections of the same loop.
   template <typename T>
+    requires std::is_base_of_v<Session, T>
   auto setNewSessionCallback() -> void {
-    _acceptor.setNewSessionCallback([this] { return newSession<T>(); });
+    // Made up front, so each pool is only ever used by its loop's thread.
+    auto pools = std::unordered_map<Loop*, std::shared_ptr<SessionPool<T>>>{};
+    for (const auto& loop : _loop_pool->loops()) {
+      pools.emplace(loop.get(), std::make_shared<SessionPool<T>>(loop));
+    }
+    _acceptor.setNewSessionCallback(
+        [this] { return _loop_pool->findNext(); },
+        [this, pools = std::move(pools)](const std::shared_ptr<Loop>& loop) {
+          return newSession(pools.at(loop.get())->acquire());
+        });
   }
 
+  // Run coroutine for every accepted session instead of the callbacks. See
+  // Session::spawn().
+  auto setSessionCoroutine(Session::Coroutine coroutine) -> void {
+    _acceptor.setSessionCoroutine(std::move(coroutine));
+  }
+
+  // Callbacks are shared by all sessions created after they are set.
   auto setConnectCallback(
       std::function<void(std::shared_ptr<Session>)> callback) -> void {
-    _connect_callback = std::move(callback);
+    mutableCallbacks().connect = std::move(callback);
   }
 
   auto setReadCallback(
       std::function<void(std::shared_ptr<Session>, Buffer&)> callback) -> void {
-    _read_callback = std::move(callback);
+    mutableCallbacks().read = std::move(callback);
   }
 
   auto setDisconnectCallback(
       std::function<void(std::shared_ptr<Session>)> callback) -> void {
-    _disconnect_callback = std::move(callback);
+    mutableCallbacks().disconnect = std::move(callback);
+  }
+
+  auto setHighWaterMarkCallback(
+      std::function<void(std::shared_ptr<Session>, std::size_t)> callback,
+      std::size_t high_water_mark = Session::DEFAULT_HIGH_WATER_MARK)
+      -> void {
+    mutableCallbacks().high_water_mark = std::move(callback);
+    _high_water_mark = high_water_mark;
+  }
+
+  auto setWriteCompleteCallback(
+      std::function<void(std::shared_ptr<Session>)> callback) -> void {
+    mutableCallbacks().write_complete = std::move(callback);
+  }
+
+  auto setMessageCallback(
+      std::function<void(std::shared_ptr<Session>, std::string_view)>
+          callback) -> void {
+    mutableCallbacks().message = std::move(callback);
+  }
+
+  // See Session::setCodec(). The codec is shared by all sessions.
+  auto setCodec(std::shared_ptr<const Codec> codec) -> void {
+    _codec = std::move(codec);
+  }
+
+  // Live sessions, to find by id or bound key or to visit them all.
+  auto sessions() -> SessionRegistry& { return *_registry; }
+
+  // Send the shared payload to every live session filter accepts (all
+  // without one), in one task per loop. filter runs on the session's loop.
+  auto broadcast(BufferSlice payload, SessionFilter filter = {}) -> void;
+
+  // broadcast() of message framed once with the server's codec.
+  auto broadcastMessage(std::string_view message, SessionFilter filter = {})
+      -> void;
+
+  // Cheap, can be called from any thread.
+  auto sessionCount() const { return _registry->size(); }
+
+  auto sessionCount(std::size_t loop_index) const {
+    return _registry->size(loop_index);
+  }
+
+  // See Session::setSharedReadBuffer().
+  auto setSharedReadBuffer(bool shared) -> void {
+    _shared_read_buffer = shared;
+  }
+
+  // Disconnect sessions that receive nothing for timeout. Zero turns it off.
+  auto setIdleTimeout(std::chrono::milliseconds timeout) -> void {
+    _idle_timeout = timeout;
+  }
+
+  // See Session::setSocketBusyPoll().
+  auto setSocketBusyPoll(std::chrono::microseconds timeout) -> void {
+    _socket_busy_poll = timeout;
   }
 
+  // The loops sessions run on, for their stats.
+  auto loops() const -> const auto& { return _loop_pool->loops(); }
+
  private:
-  template <typename T>
-    requires std::is_base_of_v<Session, T>
-  auto newSession() -> std::shared_ptr<Session> {
-    auto session = std::make_shared<T>(_loop_pool->findNext());
-    session->setConnectCallback(_connect_callback);
-    session->setReadCallback(_read_callback);
-    session->setDisconnectCallback(_disconnect_callback);
+  auto newSession(std::shared_ptr<Session> session)
+      -> std::shared_ptr<Session> {
+    session->setCallbacks(_callbacks);
+    session->setHighWaterMark(_high_water_mark);
+    session->setIdleTimeout(_idle_timeout);
+    session->setSharedReadBuffer(_shared_read_buffer);
+    session->setSocketBusyPoll(_socket_busy_poll);
+    session->setCodec(_codec);
+    session->setRegistry(_registry);
     return session;
   }
 
+  // Sessions already created keep the callbacks they were given.
+  auto mutableCallbacks() -> Session::Callbacks& {
+    _callbacks = std::make_shared<Session::Callbacks>(*_callbacks);
+    return *_callbacks;
+  }
+
  private:
   std::shared_ptr<LoopPool> _loop_pool;
   Acceptor _acceptor;
-  std::function<void(std::shared_ptr<Session>)> _connect_callback;
-  std::function<void(std::shared_ptr<Session>, Buffer&)> _read_callback;
-  std::function<void(std::shared_ptr<Session>)> _disconnect_callback;
+  std::shared_ptr<SessionRegistry> _registry;
+  std::shared_ptr<Session::Callbacks> _callbacks{
+      std::make_shared<Session::Callbacks>()};
+  std::shared_ptr<const Codec> _codec;
+  std::size_t _high_water_mark{Session::DEFAULT_HIGH_WATER_MARK};
+  std::chrono::milliseconds _idle_timeout{};
+  std::chrono::microseconds _socket_busy_poll{};
+  bool _shared_read_buffer{false};
 };
 
 }  // namespace fz::net
@@ -0,0 +1,95 @@
+#ifndef __FZ_NET_TIMING_WHEEL_H__
+#define __FZ_NET_TIMING_WHEEL_H__
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace fz::net {
+
+// Hashed timing wheel for coarse timeouts of many connections: O(1) add,
+// cancel and refresh. Use it only on the thread running the io_context.
+class TimingWheel {
+ public:
+  using Callback = std::function<void(void)>;
+
+  using Duration = std::chrono::steady_clock::duration;
+
+  constexpr static std::chrono::milliseconds DEFAULT_TICK{100};
+
+  constexpr static std::size_t DEFAULT_SLOTS = 512;
+
+ private:
+  struct Entry {
+    Entry* _prev{nullptr};
+    Entry* _next{nullptr};
+    std::uint64_t _deadline{};
+    std::size_t _slot{};
+    Callback _callback;
+  };
+
+ public:
+  // Valid from add() until the timer fires or is cancelled.
+  using TimerId = Entry*;
+
+ public:
+  explicit TimingWheel(asio::io_context& io_context,
+                       Duration tick = DEFAULT_TICK,
+                       std::size_t slots = DEFAULT_SLOTS);
+
+  TimingWheel(const TimingWheel&) = delete;
+
+  TimingWheel(TimingWheel&&) noexcept = delete;
+
+  auto operator=(const TimingWheel&) -> TimingWheel& = delete;
+
+  auto operator=(TimingWheel&&) noexcept -> TimingWheel& = delete;
+
+  ~TimingWheel();
+
+  // Run callback once after timeout, rounded up to whole ticks.
+  auto add(Duration timeout, Callback callback) -> TimerId;
+
+  // Move a pending timer's deadline; one store, it moves slot lazily.
+  auto refresh(TimerId id, Duration timeout) -> void {
+    id->_deadline = _current_tick + ticks(timeout);
+  }
+
+  auto cancel(TimerId id) -> void;
+
+  [[nodiscard]] auto size() const { return _size; }
+
+  [[nodiscard]] auto tick() const { return _tick; }
+
+ private:
+  auto ticks(Duration timeout) const -> std::uint64_t;
+
+  auto elapsedTicks() const -> std::uint64_t;
+
+  auto link(Entry* entry) -> void;
+
+  auto unlink(Entry* entry) -> void;
+
+  auto schedule() -> void;
+
+  auto advance() -> void;
+
+  auto expire(std::size_t slot) -> void;
+
+ private:
+  asio::steady_timer _timer;
+  Duration _tick;
+  std::vector<Entry*> _slots;
+  std::vector<Entry*> _expired;
+  std::chrono::steady_clock::time_point _origin;
+  std::uint64_t _current_tick{};
+  std::size_t _size{};
+  bool _ticking{false};
+};
+
+}  // namespace fz::net
+
+#endif  // __FZ_NET_TIMING_WHEEL_H__
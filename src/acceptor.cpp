@@ -1,5 +1,6 @@
 #include "fz/net/acceptor.h"
 
+#include "fz/net/common/log.h"
 #include "fz/net/session.h"
 
 namespace fz::net {
@@ -15,11 +16,27 @@ auto Acceptor::start() -> void {
   _loop->postTask([this] { listen(); });
 }
 
-auto Acceptor::stop() -> void { _acceptor.close(); }
+auto Acceptor::stop() -> void {
+  // A pending accept uses the socket on the loop thread, and the loop runs
+  // without per-socket locks.
+  _loop->postTask([this] {
+    auto ec = asio::error_code{};
+    _acceptor.close(ec);
+  });
+}
 
 auto Acceptor::setNewSessionCallback(
-    std::function<std::shared_ptr<Session>()> new_session_callback) -> void {
-  _new_session_callback = std::move(new_session_callback);
+    std::function<std::shared_ptr<Loop>()> next_loop,
+    std::function<std::shared_ptr<Session>(const std::shared_ptr<Loop>&)>
+        new_session) -> void {
+  _next_loop = std::move(next_loop);
+  _new_session_callback = std::move(new_session);
+}
+
+auto Acceptor::setSessionCoroutine(
+    std::function<asio::awaitable<void>(std::shared_ptr<Session>)> coroutine)
+    -> void {
+  _session_coroutine = std::move(coroutine);
 }
 
 auto Acceptor::listen() -> void {
@@ -28,18 +45,23 @@ auto Acceptor::listen() -> void {
   _acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
   _acceptor.bind(endpoint);
   _acceptor.listen();
+  if (_session_coroutine) {
+    asio::co_spawn(_acceptor.get_executor(), acceptLoop(), asio::detached);
+    return;
+  }
+
   accept();
 }
 
-static auto handleAccept(const auto& ec, auto& new_session,
-                         const auto& acceptor) -> int {
+static auto handleAccept(const auto& ec, const auto& acceptor) -> int {
   if (ec) {
-    new_session->disconnect();
+    if (ec != asio::error::operation_aborted) {
+      LOG_ERROR("Accept error: {}.", ec.message());
+    }
+
     return 1;
   }
 
-  new_session->start();
-
   if (!acceptor.is_open()) {
     return 1;
   }
@@ -48,15 +70,54 @@ static auto handleAccept(const auto& ec, auto& new_session,
 }
 
 auto Acceptor::accept() -> void {
-  auto new_session = _new_session_callback();
-  _acceptor.async_accept(new_session->socket(),
-                         [this, new_session](const auto& ec) {
-                           if (handleAccept(ec, new_session, _acceptor) != 0) {
-                             return;
-                           }
-
-                           accept();
-                         });
+  // Accepted straight onto the io_context of the loop that will own it.
+  auto loop = _next_loop();
+  _acceptor.async_accept(
+      loop->getIoContext(),
+      [this, loop](const auto& ec, asio::ip::tcp::socket socket) {
+        if (!ec) {
+          handOver(loop, std::move(socket));
+        }
+
+        if (handleAccept(ec, _acceptor) != 0) {
+          return;
+        }
+
+        accept();
+      });
+}
+
+auto Acceptor::acceptLoop() -> asio::awaitable<void> {
+  while (_acceptor.is_open()) {
+    auto loop = _next_loop();
+    auto ec = asio::error_code{};
+    auto socket = co_await _acceptor.async_accept(
+        loop->getIoContext(), asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      if (ec != asio::error::operation_aborted) {
+        LOG_ERROR("Accept error: {}.", ec.message());
+      }
+
+      co_return;
+    }
+
+    handOver(loop, std::move(socket));
+  }
+}
+
+auto Acceptor::handOver(std::shared_ptr<Loop> loop,
+                        asio::ip::tcp::socket socket) -> void {
+  // The session (and the pool it comes from) is only ever touched by its
+  // loop's thread, so its memory is first touched there too.
+  loop->postTask([this, loop, socket = std::move(socket)]() mutable {
+    auto session = _new_session_callback(loop);
+    session->socket() = std::move(socket);
+    if (_session_coroutine) {
+      session->spawn(_session_coroutine);
+    } else {
+      session->start();
+    }
+  });
 }
 
 }  // namespace fz::net
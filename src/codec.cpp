@@ -0,0 +1,118 @@
+#include "fz/net/codec.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "fz/net/common/log.h"
+
+namespace fz::net {
+
+static auto roundFieldSize(std::size_t field_size) -> std::size_t {
+  return std::clamp<std::size_t>(std::bit_ceil(field_size), 1, 8);
+}
+
+LengthFieldCodec::LengthFieldCodec(std::size_t field_size,
+                                   ByteOrder byte_order,
+                                   std::size_t max_frame)
+    : _field_size{roundFieldSize(field_size)},
+      _byte_order{byte_order},
+      _max_frame{max_frame} {}
+
+auto LengthFieldCodec::decode(const Buffer& buffer, Frame& frame) const
+    -> Status {
+  if (buffer.readableBytes() < _field_size) {
+    return Status::Incomplete;
+  }
+
+  const auto* field =
+      reinterpret_cast<const unsigned char*>(buffer.readBegin());
+  std::uint64_t length = 0;
+  for (std::size_t i = 0; i < _field_size; ++i) {
+    auto index =
+        _byte_order == ByteOrder::BigEndian ? i : _field_size - 1 - i;
+    length = (length << 8) | field[index];
+  }
+
+  if (_max_frame < length) {
+    return Status::Invalid;
+  }
+
+  if (buffer.readableBytes() - _field_size < length) {
+    return Status::Incomplete;
+  }
+
+  frame.message = {buffer.readBegin() + _field_size,
+                   static_cast<std::size_t>(length)};
+  frame.size = _field_size + frame.message.size();
+  return Status::Complete;
+}
+
+auto LengthFieldCodec::encode(std::string_view message) const -> Buffer {
+  auto limit = _max_frame;
+  if (_field_size < sizeof(std::uint64_t)) {
+    auto field_max = (std::uint64_t{1} << (8 * _field_size)) - 1;
+    limit = std::min<std::size_t>(limit, field_max);
+  }
+  if (limit < message.size()) {
+    LOG_ERROR("Message of {} bytes exceeds frame limit {}.", message.size(),
+              limit);
+    return {};
+  }
+
+  // The header goes into the prepend area, in front of the copied message.
+  auto buffer = Buffer{};
+  buffer.append(message);
+  auto length = message.size();
+  auto big_endian = _byte_order == ByteOrder::BigEndian;
+  if (_field_size == 1) {
+    buffer.prependInt8(static_cast<std::int8_t>(length));
+  } else if (_field_size == 2) {
+    auto value = static_cast<std::int16_t>(length);
+    big_endian ? buffer.prependInt16BE(value) : buffer.prependInt16LE(value);
+  } else if (_field_size == 4) {
+    auto value = static_cast<std::int32_t>(length);
+    big_endian ? buffer.prependInt32BE(value) : buffer.prependInt32LE(value);
+  } else {
+    auto value = static_cast<std::int64_t>(length);
+    big_endian ? buffer.prependInt64BE(value) : buffer.prependInt64LE(value);
+  }
+  return buffer;
+}
+
+LineCodec::LineCodec(std::string_view delimiter, std::size_t max_frame)
+    : _delimiter{delimiter}, _max_frame{max_frame} {}
+
+auto LineCodec::decode(const Buffer& buffer, Frame& frame) const -> Status {
+  auto pos = Buffer::npos;
+  if (_delimiter == "\r\n") {
+    pos = buffer.findCRLF();
+  } else if (_delimiter.size() == 1) {
+    pos = buffer.findByte(_delimiter.front());
+  } else {
+    pos = std::string_view{buffer.readBegin(), buffer.readableBytes()}.find(
+        _delimiter);
+  }
+
+  if (pos == Buffer::npos) {
+    return _max_frame < buffer.readableBytes() ? Status::Invalid
+                                               : Status::Incomplete;
+  }
+
+  if (_max_frame < pos) {
+    return Status::Invalid;
+  }
+
+  frame.message = {buffer.readBegin(), pos};
+  frame.size = pos + _delimiter.size();
+  return Status::Complete;
+}
+
+auto LineCodec::encode(std::string_view message) const -> Buffer {
+  auto buffer = Buffer{};
+  buffer.ensureWritableBytes(message.size() + _delimiter.size());
+  buffer.append(message);
+  buffer.append(_delimiter);
+  return buffer;
+}
+
+}  // namespace fz::net
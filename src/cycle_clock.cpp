@@ -0,0 +1,28 @@
+#include "fz/net/common/cycle_clock.h"
+
+namespace fz::net {
+
+auto CycleClock::nanosPerTick() -> double {
+#if defined(__x86_64__) || defined(__i386__)
+  // Spin for a few milliseconds; long enough for the ratio to settle to a
+  // fraction of a percent.
+  static const double rate = [] {
+    using Clock = std::chrono::steady_clock;
+    constexpr auto SPAN = std::chrono::milliseconds(5);
+    auto start = Clock::now();
+    auto start_ticks = now();
+    auto end = start;
+    while (end - start < SPAN) {
+      end = Clock::now();
+    }
+    auto ticks = now() - start_ticks;
+    auto nanos = std::chrono::duration<double, std::nano>(end - start);
+    return ticks == 0 ? 1.0 : nanos.count() / static_cast<double>(ticks);
+  }();
+  return rate;
+#else
+  return 1.0;
+#endif
+}
+
+}  // namespace fz::net
@@ -0,0 +1,150 @@
+#include "fz/net/common/file_region.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
+
+#include "fz/net/common/log.h"
+
+namespace fz::net {
+
+static auto lastError() -> asio::error_code {
+  return {errno, asio::error::get_system_category()};
+}
+
+FileRegion::FileRegion(int fd, std::uint64_t offset, std::size_t length)
+    : _fd{::dup(fd)}, _offset{offset}, _size{length} {
+  if (_fd < 0) {
+    LOG_ERROR("Duplicate fd {} failed: {}.", fd, lastError().message());
+    _size = 0;
+  }
+}
+
+FileRegion::~FileRegion() {
+  if (0 <= _fd) {
+    ::close(_fd);
+  }
+}
+
+auto FileRegion::sendTo(int socket, asio::error_code& ec) -> std::size_t {
+  ec = {};
+  auto len = std::min(_size, MAX_TRANSFER_BYTES);
+  if (len == 0) {
+    return 0;
+  }
+
+  auto sent = std::size_t{0};
+  if (!_use_mmap) {
+    sent = sendfileTo(socket, len, ec);
+    // Not every file type can be sent with sendfile; fall back for good.
+    if (ec == asio::error::invalid_argument ||
+        ec == asio::error::operation_not_supported || ec.value() == ENOSYS) {
+      LOG_DEBUG("sendfile unsupported for fd {}: {}. Use mmap.", _fd,
+                ec.message());
+      _use_mmap = true;
+      ec = {};
+    }
+  }
+
+  if (_use_mmap) {
+    sent = mmapTo(socket, len, ec);
+  }
+
+  _offset += sent;
+  _size -= sent;
+  return sent;
+}
+
+auto FileRegion::sendfileTo(int socket, std::size_t len, asio::error_code& ec)
+    -> std::size_t {
+#if defined(__linux__)
+  auto offset = static_cast<off_t>(_offset);
+  auto n = ::sendfile(socket, _fd, &offset, len);
+  if (n < 0) {
+    ec = lastError();
+    return 0;
+  }
+
+  if (n == 0) {
+    ec = asio::error::eof;  // file shorter than the region
+  }
+
+  return static_cast<std::size_t>(n);
+#elif defined(__APPLE__)
+  auto sent = static_cast<off_t>(len);
+  // On EAGAIN, sent still reports the bytes written before the error.
+  if (::sendfile(_fd, socket, static_cast<off_t>(_offset), &sent, nullptr,
+                 0) < 0 &&
+      sent == 0) {
+    ec = lastError();
+    return 0;
+  }
+
+  if (sent == 0) {
+    ec = asio::error::eof;
+  }
+
+  return static_cast<std::size_t>(sent);
+#else
+  (void)socket;
+  (void)len;
+  ec = asio::error::operation_not_supported;
+  return 0;
+#endif
+}
+
+auto FileRegion::mmapTo(int socket, std::size_t len, asio::error_code& ec)
+    -> std::size_t {
+  struct stat st {};
+  if (::fstat(_fd, &st) < 0) {
+    ec = lastError();
+    return 0;
+  }
+
+  // Never touch pages past the end of the file.
+  auto file_size = static_cast<std::uint64_t>(st.st_size);
+  if (file_size <= _offset) {
+    ec = asio::error::eof;
+    return 0;
+  }
+  len = static_cast<std::size_t>(
+      std::min<std::uint64_t>(len, file_size - _offset));
+
+  static const auto page_size =
+      static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+  auto aligned_offset = _offset - (_offset % page_size);
+  auto skip = static_cast<std::size_t>(_offset - aligned_offset);
+  auto* addr = ::mmap(nullptr, skip + len, PROT_READ, MAP_SHARED, _fd,
+                      static_cast<off_t>(aligned_offset));
+  if (addr == MAP_FAILED) {
+    ec = lastError();
+    return 0;
+  }
+
+#ifdef MSG_NOSIGNAL
+  constexpr int flags = MSG_NOSIGNAL;
+#else
+  constexpr int flags = 0;
+#endif
+  auto n = ::send(socket, static_cast<const char*>(addr) + skip, len, flags);
+  if (n < 0) {
+    ec = lastError();
+    n = 0;
+  }
+
+  ::munmap(addr, skip + len);
+  return static_cast<std::size_t>(n);
+}
+
+}  // namespace fz::net
@@ -1,30 +1,427 @@
 #include "fz/net/loop.h"
 
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "fz/net/common/cycle_clock.h"
+#include "fz/net/common/log.h"
+#include "fz/net/common/relaxed_counter.h"
+
 namespace fz::net {
 
-Loop::Loop() : _work{_io_context} {}
+static std::atomic<std::uint64_t> loop_count{};
+
+// One in METRICS_SAMPLE_INTERVAL of the tasks a thread posts is timed.
+static auto sampleTask() -> bool {
+  thread_local std::uint32_t posted = 0;
+  return ++posted % Loop::METRICS_SAMPLE_INTERVAL == 0;
+}
+
+// CPU time of the calling thread, which does not advance while it sleeps.
+static auto threadCpuNanos() -> std::int64_t {
+  auto now = timespec{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<std::int64_t>(now.tv_sec) * 1'000'000'000 + now.tv_nsec;
+}
+
+Loop::Loop(int concurrency_hint)
+    : _id{loop_count.fetch_add(1, std::memory_order_relaxed) + 1},
+      _io_context{concurrency_hint},
+      _work{_io_context} {
+  // Without an eventfd _wakeup stays closed and wakeUp() posts to the
+  // io_context instead.
+#if defined(__linux__)
+  auto fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    LOG_ERROR("Loop {}: no eventfd, wake up through the io_context: {}", _id,
+              std::strerror(errno));
+    return;
+  }
+  _wakeup.assign(fd);
+#endif
+}
 
 Loop::~Loop() {
   if (_thread.joinable()) {
     _thread.join();
   }
+  while (auto* node = _inbox.pop()) {
+    NodeCache<InboxNode>::recycle(node);
+  }
 }
 
 auto Loop::start() -> void {
   _thread = std::thread([this] { run(); });
 }
 
+auto Loop::start(ThreadOptions options) -> void {
+  _thread = std::thread([this, options = std::move(options)] {
+    applyThreadOptions(options);
+    run();
+  });
+}
+
+auto Loop::applyThreadOptions(const ThreadOptions& options) -> void {
+  if (!options.name.empty()) {
+#if defined(__linux__)
+    auto name = options.name.substr(0, 15);
+    auto err = pthread_setname_np(pthread_self(), name.c_str());
+#elif defined(__APPLE__)
+    const auto& name = options.name;
+    auto err = pthread_setname_np(name.c_str());
+#else
+    const auto& name = options.name;
+    auto err = ENOTSUP;
+#endif
+    if (err != 0) {
+      LOG_ERROR("Loop {}: cannot name thread {}: {}", _id, name,
+                std::strerror(err));
+    }
+  }
+
+  if (options.cpus.empty()) {
+    if (options.numa_local) {
+      LOG_WARN("Loop {}: numa_local ignored: the thread is not pinned.", _id);
+    }
+    return;
+  }
+
+#if defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (auto cpu : options.cpus) {
+    if (0 <= cpu && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpus);
+    }
+  }
+  if (auto err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      err != 0) {
+    LOG_ERROR("Loop {}: cannot pin thread: {}", _id, std::strerror(err));
+    return;
+  }
+
+  if (!options.numa_local) {
+    return;
+  }
+
+  // The thread is pinned, so the CPU it runs on now is one of its set.
+  auto cpu = 0U;
+  auto node = 0U;
+  if (getcpu(&cpu, &node) != 0) {
+    LOG_ERROR("Loop {}: cannot get NUMA node: {}", _id, std::strerror(errno));
+    return;
+  }
+
+  constexpr auto MASK_BITS = 8 * sizeof(unsigned long);
+  if (MASK_BITS <= node) {
+    LOG_ERROR("Loop {}: NUMA node {} out of range.", _id, node);
+    return;
+  }
+
+  // No libnuma: MPOL_PREFERRED falls back to other nodes when this one is
+  // full instead of failing the allocation.
+  auto mask = 1UL << node;
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, MASK_BITS + 1) != 0) {
+    LOG_ERROR("Loop {}: cannot prefer NUMA node {}: {}", _id, node,
+              std::strerror(errno));
+    return;
+  }
+
+  _numa_node.store(static_cast<int>(node), std::memory_order_relaxed);
+#else
+  LOG_ERROR("Loop {}: cannot pin thread: not supported on this platform.",
+            _id);
+#endif
+}
+
 auto Loop::stop() -> void {
-  _io_context.stop();
+  // Queued behind pending tasks, so work handed to the loop just before,
+  // such as closing an acceptor, still runs on the loop thread.
+  if (isRunning() && !isInLoopThread()) {
+    postTask([this] { _io_context.stop(); });
+  } else {
+    _io_context.stop();
+  }
   if (_thread.joinable()) {
     _thread.join();
   }
 }
 
-auto Loop::postTask(std::function<void(void)> func) -> void {
-  asio::post(_io_context, func);
+auto Loop::postTask(Task task) -> void {
+  auto* node = NodeCache<InboxNode>::make(std::move(task));
+  if (metricsEnabled() && sampleTask()) {
+    node->enqueued = CycleClock::now();
+  }
+  _inbox.push(node);
+  if (!_inbox_scheduled.exchange(true)) {
+    wakeUp();
+  }
+}
+
+auto Loop::wakeUp() -> void {
+  _inbox_wakeups.fetch_add(1, std::memory_order_relaxed);
+  if (!_wakeup.is_open()) {
+    asio::post(_io_context, [this] { drainInbox(); });
+    return;
+  }
+
+  // Fails only when the counter would overflow, with a wakeup pending.
+  std::uint64_t one = 1;
+  [[maybe_unused]] auto n = ::write(_wakeup.native_handle(), &one, sizeof(one));
 }
 
-auto Loop::run() -> void { _io_context.run(); }
+auto Loop::waitForWakeUp() -> void {
+  _wakeup.async_wait(asio::posix::stream_descriptor::wait_read,
+                     [this](const auto& ec) {
+                       if (ec) {
+                         return;  // closed with the loop
+                       }
+
+                       std::uint64_t count = 0;
+                       [[maybe_unused]] auto n = ::read(
+                           _wakeup.native_handle(), &count, sizeof(count));
+                       drainInbox();
+                       // Armed again before the reactor polls, so a wakeup
+                       // written meanwhile is not missed.
+                       waitForWakeUp();
+                     });
+}
+
+auto Loop::drainInbox() -> void {
+  auto limit = _inbox_batch_size.load(std::memory_order_relaxed);
+  std::size_t n = 0;
+  while (n < limit) {
+    auto* node = _inbox.pop();
+    if (node == nullptr) {
+      break;
+    }
+    if (node->enqueued == 0) {
+      node->task();
+    } else {
+      auto start = CycleClock::now();
+      // Counters of different cores may be slightly apart.
+      auto delay = node->enqueued < start ? start - node->enqueued : 0;
+      _enqueue_delay.record(CycleClock::toNanos(delay));
+      node->task();
+      _handler_time.record(CycleClock::toNanos(CycleClock::now() - start));
+    }
+    NodeCache<InboxNode>::recycle(node);
+    ++n;
+  }
+  bumpCounter(_inbox_tasks, n);
+  bumpCounter(_inbox_batches, 1);
+
+  // The flag stays set while tasks are left, so producers do not wake the
+  // loop for them.
+  if (n == limit) {
+    continueInbox();
+    return;
+  }
+
+  _inbox_scheduled.store(false);
+  // A push may have landed after the last pop but seen the flag still set.
+  // Take the drain back in that case.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!_inbox.empty() && !_inbox_scheduled.exchange(true)) {
+    continueInbox();
+  }
+}
+
+auto Loop::continueInbox() -> void {
+  // Posted rather than looped, so socket handlers run in between.
+  asio::post(_io_context, [this] { drainInbox(); });
+}
+
+auto Loop::setMetricsEnabled(bool enabled) -> void {
+  if constexpr (METRICS_SUPPORTED) {
+    if (enabled) {
+      CycleClock::calibrate();
+    }
+    _metrics_enabled.store(enabled, std::memory_order_relaxed);
+  }
+}
+
+auto Loop::busyPollStats() const -> BusyPollStats {
+  return {_busy_polls.load(std::memory_order_relaxed),
+          _busy_useful_polls.load(std::memory_order_relaxed),
+          _busy_spin_nanos.load(std::memory_order_relaxed),
+          _busy_blocks.load(std::memory_order_relaxed)};
+}
+
+auto Loop::inboxStats() const -> InboxStats {
+  return {_inbox_tasks.load(std::memory_order_relaxed),
+          _inbox_wakeups.load(std::memory_order_relaxed),
+          _inbox_batches.load(std::memory_order_relaxed)};
+}
+
+auto Loop::postTasks(std::span<Task> tasks) -> void {
+  if (tasks.empty()) {
+    return;
+  }
+
+  auto batch = std::vector<Task>{std::make_move_iterator(tasks.begin()),
+                                 std::make_move_iterator(tasks.end())};
+  postTask([batch = std::move(batch)]() mutable {
+    for (auto& task : batch) {
+      task();
+    }
+  });
+}
+
+auto Loop::run() -> void {
+  // sendfile(2) raises SIGPIPE on a reset connection. Block it on the loop
+  // thread so the call fails with EPIPE instead.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  _thread_id.store(std::this_thread::get_id(), std::memory_order_release);
+  BufferPool::setLocal(&_buffer_pool);
+  // After the thread options, so it lands on the loop's NUMA node.
+  if (!_read_scratch) {
+    _read_scratch = std::make_unique_for_overwrite<char[]>(READ_SCRATCH_SIZE);
+  }
+#ifdef ASIO_HAS_IO_URING_AS_DEFAULT
+  registerReadBuffers();
+#endif
+  if (_wakeup.is_open()) {
+    waitForWakeUp();
+  }
+  if (0 < _busy_poll_budget.count()) {
+    runBusyPoll();
+  } else if constexpr (METRICS_SUPPORTED) {
+    runMeasured();
+  } else {
+    _io_context.run();
+  }
+  BufferPool::setLocal(nullptr);
+  _thread_id.store({}, std::memory_order_release);
+}
+
+#ifdef ASIO_HAS_IO_URING_AS_DEFAULT
+auto Loop::registerReadBuffers() -> void {
+  // Allocated and first touched on the loop thread, so the pages come from
+  // its NUMA node.
+  constexpr auto TOTAL = REGISTERED_READ_BUFFERS * REGISTERED_READ_BUFFER_SIZE;
+  _read_buffer_memory = std::make_unique<char[]>(TOTAL);
+  auto buffers = std::vector<asio::mutable_buffer>{};
+  buffers.reserve(REGISTERED_READ_BUFFERS);
+  for (std::size_t i = 0; i < REGISTERED_READ_BUFFERS; ++i) {
+    buffers.push_back(asio::buffer(
+        _read_buffer_memory.get() + i * REGISTERED_READ_BUFFER_SIZE,
+        REGISTERED_READ_BUFFER_SIZE));
+  }
+
+  // asio only reports a failed registration by throwing.
+  try {
+    _read_registration.emplace(asio::register_buffers(_io_context, buffers));
+  } catch (const std::exception& e) {
+    LOG_ERROR("Loop {}: cannot register read buffers, reading without: {}",
+              _id, e.what());
+    _read_buffer_memory.reset();
+    return;
+  }
+
+  _free_read_buffers.reserve(REGISTERED_READ_BUFFERS);
+  for (auto i = REGISTERED_READ_BUFFERS; 0 < i; --i) {
+    _free_read_buffers.push_back(i - 1);
+  }
+}
+
+auto Loop::acquireReadBuffer() -> std::optional<std::size_t> {
+  if (_free_read_buffers.empty()) {
+    return std::nullopt;
+  }
+
+  auto index = _free_read_buffers.back();
+  _free_read_buffers.pop_back();
+  return index;
+}
+#endif
+
+auto Loop::runMeasured() -> void {
+  // run() would never come back to look at the switch. Instead poll_one()
+  // runs one ready handler without blocking and is timed as one turn, and
+  // run_one() waits when nothing is ready. A turn that starts with a wait
+  // is timed in thread CPU time, which leaves the sleep out but keeps the
+  // cost of the epoll_wait call itself.
+  while (!_io_context.stopped()) {
+    if (!metricsEnabled()) {
+      _io_context.run_one();
+      continue;
+    }
+
+    auto start = CycleClock::now();
+    if (0 < _io_context.poll_one()) {
+      _iteration_time.record(CycleClock::toNanos(CycleClock::now() - start));
+      continue;
+    }
+
+    auto cpu_start = threadCpuNanos();
+    if (0 < _io_context.run_one()) {
+      _iteration_time.record(
+          static_cast<std::uint64_t>(threadCpuNanos() - cpu_start));
+    }
+  }
+}
+
+auto Loop::runBusyPoll() -> void {
+  // poll_one() runs a ready handler or, with none, asks epoll for events
+  // without waiting. Spin on it until work shows up or the budget is gone,
+  // then sleep in run_one() as usual.
+  CycleClock::calibrate();
+  auto budget = static_cast<std::uint64_t>(
+      std::chrono::nanoseconds(_busy_poll_budget).count());
+  while (!_io_context.stopped()) {
+    auto idle_since = CycleClock::now();
+    auto spin_end = idle_since;
+    auto found = false;
+    while (true) {
+      spin_end = CycleClock::now();
+      found = 0 < _io_context.poll_one();
+      bumpCounter(_busy_polls, 1);
+      if (found || _io_context.stopped() ||
+          budget <= CycleClock::toNanos(CycleClock::now() - idle_since)) {
+        break;
+      }
+    }
+    bumpCounter(_busy_spin_nanos, CycleClock::toNanos(spin_end - idle_since));
+
+    if (found) {
+      bumpCounter(_busy_useful_polls, 1);
+      if (metricsEnabled()) {
+        _iteration_time.record(
+            CycleClock::toNanos(CycleClock::now() - spin_end));
+      }
+      continue;
+    }
+
+    if (!_io_context.stopped()) {
+      bumpCounter(_busy_blocks, 1);
+      _io_context.run_one();
+    }
+  }
+}
 
 }  // namespace fz::net
@@ -1,17 +1,65 @@
 #include "fz/net/loop_pool.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <string>
+#include <utility>
+
+#include "fz/net/common/log.h"
+
 namespace fz::net {
 
-LoopPool::LoopPool(std::size_t size) {
+LoopPool::LoopPool(std::size_t size, LoopPoolOptions options)
+    : _options{std::move(options)} {
   _loops.reserve(size);
   for (std::size_t i = 0; i < size; ++i) {
-    _loops.push_back(std::make_shared<Loop>());
+    _loops.push_back(std::make_shared<Loop>(_options.concurrency_hint));
+    _loops.back()->setInboxBatchSize(_options.inbox_batch_size);
+    _loops.back()->setBusyPoll(_options.busy_poll);
   }
 }
 
+auto LoopPool::cpuPerLoop(std::size_t size)
+    -> std::vector<std::vector<int>> {
+#if defined(__linux__)
+  auto online = std::vector<int>{};
+  cpu_set_t cpus;
+  if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpus)) {
+        online.push_back(cpu);
+      }
+    }
+  }
+  if (online.empty()) {
+    return {};
+  }
+
+  auto sets = std::vector<std::vector<int>>{};
+  for (std::size_t i = 0; i < size; ++i) {
+    sets.push_back({online[i % online.size()]});
+  }
+  return sets;
+#else
+  LOG_ERROR("Cannot pin {} loop(s): not supported on this platform.", size);
+  return {};
+#endif
+}
+
 auto LoopPool::start() -> void {
-  for (auto& loop : _loops) {
-    loop->start();
+  LOG_DEBUG("Starting {} loop(s) on {}.", _loops.size(), Loop::backendName());
+  for (std::size_t i = 0; i < _loops.size(); ++i) {
+    auto options = Loop::ThreadOptions{};
+    if (!_options.name.empty()) {
+      options.name = _options.name + "-" + std::to_string(i);
+    }
+    if (!_options.cpu_sets.empty()) {
+      options.cpus = _options.cpu_sets[i % _options.cpu_sets.size()];
+    }
+    options.numa_local = _options.numa_local;
+    _loops[i]->start(std::move(options));
   }
 }
 
@@ -0,0 +1,271 @@
+#include "fz/net/common/search.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define FZ_NET_SEARCH_X86
+#define FZ_NET_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace fz::net::common {
+
+namespace {
+
+// Sets with more delimiters than this fall back to the table lookup.
+constexpr std::size_t MAX_SIMD_SET_SIZE = 8;
+
+struct SearchImpl {
+  const char* (*find_byte)(const char*, const char*, char);
+  const char* (*find_crlf)(const char*, const char*);
+  const char* (*find_any_of)(const char*, const char*, std::string_view);
+  std::string_view name;
+};
+
+auto findByteScalar(const char* begin, const char* end, char c)
+    -> const char* {
+  if (begin == end) {
+    return end;
+  }
+
+  const auto* p =
+      static_cast<const char*>(std::memchr(begin, c, end - begin));
+  return p == nullptr ? end : p;
+}
+
+auto findCRLFScalar(const char* begin, const char* end) -> const char* {
+  while (begin < end) {
+    const auto* p = findByteScalar(begin, end, '\r');
+    if (end - p < 2) {
+      return end;
+    }
+
+    if (p[1] == '\n') {
+      return p;
+    }
+
+    begin = p + 1;
+  }
+
+  return end;
+}
+
+auto findAnyOfScalar(const char* begin, const char* end, std::string_view set)
+    -> const char* {
+  auto table = std::array<bool, 256>{};
+  for (auto c : set) {
+    table[static_cast<unsigned char>(c)] = true;
+  }
+
+  for (; begin < end; ++begin) {
+    if (table[static_cast<unsigned char>(*begin)]) {
+      return begin;
+    }
+  }
+
+  return end;
+}
+
+#ifdef FZ_NET_SEARCH_X86
+
+auto load128(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+auto mask128(__m128i v) {
+  return static_cast<unsigned>(_mm_movemask_epi8(v));
+}
+
+auto findByteSse2(const char* begin, const char* end, char c) -> const char* {
+  const auto needle = _mm_set1_epi8(c);
+  auto p = begin;
+  for (; p + 16 <= end; p += 16) {
+    auto mask = mask128(_mm_cmpeq_epi8(load128(p), needle));
+    if (mask != 0) {
+      return p + std::countr_zero(mask);
+    }
+  }
+
+  return findByteScalar(p, end, c);
+}
+
+auto findCRLFSse2(const char* begin, const char* end) -> const char* {
+  const auto cr = _mm_set1_epi8('\r');
+  const auto lf = _mm_set1_epi8('\n');
+  auto p = begin;
+  // Compare every position with '\r' and the position after it with '\n'.
+  for (; p + 17 <= end; p += 16) {
+    auto mask = mask128(_mm_and_si128(_mm_cmpeq_epi8(load128(p), cr),
+                                      _mm_cmpeq_epi8(load128(p + 1), lf)));
+    if (mask != 0) {
+      return p + std::countr_zero(mask);
+    }
+  }
+
+  return findCRLFScalar(p, end);
+}
+
+auto findAnyOfSse2(const char* begin, const char* end, std::string_view set)
+    -> const char* {
+  if (MAX_SIMD_SET_SIZE < set.size()) {
+    return findAnyOfScalar(begin, end, set);
+  }
+
+  __m128i needles[MAX_SIMD_SET_SIZE];
+  for (std::size_t i = 0; i < set.size(); ++i) {
+    needles[i] = _mm_set1_epi8(set[i]);
+  }
+
+  auto p = begin;
+  for (; p + 16 <= end; p += 16) {
+    auto chunk = load128(p);
+    auto hits = _mm_setzero_si128();
+    for (std::size_t i = 0; i < set.size(); ++i) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, needles[i]));
+    }
+
+    auto mask = mask128(hits);
+    if (mask != 0) {
+      return p + std::countr_zero(mask);
+    }
+  }
+
+  return findAnyOfScalar(p, end, set);
+}
+
+FZ_NET_TARGET_AVX2 auto load256(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+FZ_NET_TARGET_AVX2 auto mask256(__m256i v) {
+  return static_cast<unsigned>(_mm256_movemask_epi8(v));
+}
+
+// The AVX2 loops look at 64 bytes per iteration and fold the two halves into
+// one 64-bit mask.
+FZ_NET_TARGET_AVX2 auto mask512(__m256i lo, __m256i hi) -> std::uint64_t {
+  return static_cast<std::uint64_t>(mask256(lo)) |
+         (static_cast<std::uint64_t>(mask256(hi)) << 32);
+}
+
+FZ_NET_TARGET_AVX2 auto findByteAvx2(const char* begin, const char* end,
+                                     char c) -> const char* {
+  const auto needle = _mm256_set1_epi8(c);
+  auto p = begin;
+  for (; p + 64 <= end; p += 64) {
+    auto lo = _mm256_cmpeq_epi8(load256(p), needle);
+    auto hi = _mm256_cmpeq_epi8(load256(p + 32), needle);
+    if (_mm256_testz_si256(_mm256_or_si256(lo, hi), _mm256_set1_epi8(-1))) {
+      continue;
+    }
+
+    return p + std::countr_zero(mask512(lo, hi));
+  }
+
+  return findByteSse2(p, end, c);
+}
+
+FZ_NET_TARGET_AVX2 auto findCRLFAvx2(const char* begin, const char* end)
+    -> const char* {
+  const auto cr = _mm256_set1_epi8('\r');
+  const auto lf = _mm256_set1_epi8('\n');
+  auto p = begin;
+  for (; p + 64 <= end; p += 64) {
+    auto lo = load256(p);
+    auto hi = load256(p + 32);
+    auto cr_mask =
+        mask512(_mm256_cmpeq_epi8(lo, cr), _mm256_cmpeq_epi8(hi, cr));
+    if (cr_mask == 0) {
+      continue;
+    }
+
+    auto lf_mask =
+        mask512(_mm256_cmpeq_epi8(lo, lf), _mm256_cmpeq_epi8(hi, lf));
+    auto hits = cr_mask & (lf_mask >> 1);
+    if (hits != 0) {
+      return p + std::countr_zero(hits);
+    }
+
+    // '\r' in the last byte of the block pairs with the next block.
+    if ((cr_mask >> 63) != 0 && p + 64 < end && p[64] == '\n') {
+      return p + 63;
+    }
+  }
+
+  return findCRLFSse2(p, end);
+}
+
+FZ_NET_TARGET_AVX2 auto findAnyOfAvx2(const char* begin, const char* end,
+                                      std::string_view set) -> const char* {
+  if (MAX_SIMD_SET_SIZE < set.size()) {
+    return findAnyOfScalar(begin, end, set);
+  }
+
+  __m256i needles[MAX_SIMD_SET_SIZE];
+  for (std::size_t i = 0; i < set.size(); ++i) {
+    needles[i] = _mm256_set1_epi8(set[i]);
+  }
+
+  auto p = begin;
+  for (; p + 32 <= end; p += 32) {
+    auto chunk = load256(p);
+    auto hits = _mm256_setzero_si256();
+    for (std::size_t i = 0; i < set.size(); ++i) {
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, needles[i]));
+    }
+
+    auto mask = mask256(hits);
+    if (mask != 0) {
+      return p + std::countr_zero(mask);
+    }
+  }
+
+  return findAnyOfSse2(p, end, set);
+}
+
+#endif  // FZ_NET_SEARCH_X86
+
+auto selectImpl() -> SearchImpl {
+#ifdef FZ_NET_SEARCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return {findByteAvx2, findCRLFAvx2, findAnyOfAvx2, "avx2"};
+  }
+
+  return {findByteSse2, findCRLFSse2, findAnyOfSse2, "sse2"};
+#else
+  return {findByteScalar, findCRLFScalar, findAnyOfScalar, "scalar"};
+#endif
+}
+
+auto impl() -> const SearchImpl& {
+  static const auto impl = selectImpl();
+  return impl;
+}
+
+}  // namespace
+
+auto findByte(const char* begin, const char* end, char c) -> const char* {
+  return impl().find_byte(begin, end, c);
+}
+
+auto findCRLF(const char* begin, const char* end) -> const char* {
+  return impl().find_crlf(begin, end);
+}
+
+auto findAnyOf(const char* begin, const char* end, std::string_view set)
+    -> const char* {
+  if (set.size() == 1) {
+    return findByte(begin, end, set.front());
+  }
+
+  return impl().find_any_of(begin, end, set);
+}
+
+auto searchImplName() -> std::string_view { return impl().name; }
+
+}  // namespace fz::net::common
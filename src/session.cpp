@@ -1,18 +1,79 @@
 #include "fz/net/session.h"
 
+#include <sys/socket.h>
+
 #include <asio.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <cstddef>
-#include <mutex>
+#include <cstring>
+#include <exception>
+#include <span>
+#include <utility>
+#include <variant>
 
 #include "fz/net/common/buffer.h"
 #include "fz/net/common/log.h"
 
 namespace fz::net {
 
-auto Session::start() -> void {
+Session::~Session() {
+  while (auto* node = _unsent_items.pop()) {
+    NodeCache<WriteNode>::recycle(node);
+  }
+}
+
+auto Session::reset() -> void {
+  auto ec = asio::error_code{};
+  _socket.close(ec);
+  _timer.cancel();
+  while (auto* node = _unsent_items.pop()) {
+    NodeCache<WriteNode>::recycle(node);
+  }
+  _sending_items.clear();
+  _write_iovecs.reset();
+  _write_scheduled.store(false);
+  _writing = false;
+  _wrote_since_complete = false;
+  _pending_bytes.store(0);
+  _above_high_water_mark.store(false);
+  setHighWaterMark(DEFAULT_HIGH_WATER_MARK);
+  _upstream.reset();
+  _disconnecting.store(false);
+  _read_paused = false;
+  _read_stopped = false;
+  _read_buffer = Buffer{0};
+  _shared_read_buffer = false;
+  _callbacks.reset();
+  _codec.reset();
+  _reconnect = false;
+  _reconnect_times = DEFAULT_RECONNECT_TIMES;
+  _reconnect_delay_ms = DEFAULT_RECONNECT_DELAY_MS;
+  _idle_timeout = {};
+  _socket_busy_poll = {};
+  // A wheel entry still pending only holds a reference that has expired.
+  _idle_timer = nullptr;
+  _registry.reset();
+  _id = _loop->nextSessionId();
+  _remote_ip.clear();
+  _remote_port = 0;
+  _write_calls.store(0);
+}
+
+auto Session::mutableCallbacks() -> Callbacks& {
+  auto callbacks = _callbacks ? std::make_shared<Callbacks>(*_callbacks)
+                              : std::make_shared<Callbacks>();
+  auto& ref = *callbacks;
+  _callbacks = std::move(callbacks);
+  return ref;
+}
+
+auto Session::open() -> bool {
   if (!socket().is_open()) {
     LOG_ERROR("Socket is not open.");
-    return;
+    return false;
   }
 
   // race condition?
@@ -20,27 +81,165 @@ auto Session::start() -> void {
   _remote_port = _socket.remote_endpoint().port();
   LOG_DEBUG("Session ID: {}. Remote: {}:{}. Start", _id, _remote_ip,
             _remote_port);
-  if (_connect_callback) {
-    _connect_callback(shared_from_this());
+  _socket.non_blocking(true);
+  _disconnecting.store(false, std::memory_order_relaxed);
+  if (0 < _socket_busy_poll.count()) {
+    setBusyPollOption();
+  }
+  return true;
+}
+
+auto Session::setBusyPollOption() -> void {
+#ifdef SO_BUSY_POLL
+  auto usecs = static_cast<int>(_socket_busy_poll.count());
+  if (::setsockopt(_socket.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &usecs,
+                   sizeof(usecs)) != 0) {
+    LOG_ERROR("Session ID: {}. SO_BUSY_POLL: {}", _id, std::strerror(errno));
+  }
+#else
+  LOG_ERROR("Session ID: {}. SO_BUSY_POLL is not supported", _id);
+#endif
+}
+
+auto Session::start() -> void {
+  if (!open()) {
+    return;
   }
 
   auto self = shared_from_this();
-  read();
+  if (auto registry = _registry.lock()) {
+    registry->add(self);
+  }
+
+  onConnect();
+
+  if (0 < _idle_timeout.count()) {
+    _loop->postTask([this, self] { startIdleTimer(); });
+  }
+
+  doRead();
 }
 
-auto Session::disconnect() -> void {
+auto Session::spawn(const Coroutine& coroutine) -> void {
+  if (!open()) {
+    return;
+  }
+
+  // Frames come from asio's per-thread recycling allocator, so a coroutine
+  // per connection does not cost a fresh allocation each time.
   auto self = shared_from_this();
-  if (_disconnect_callback) {
-    _disconnect_callback(shared_from_this());
+  auto registry = _registry.lock();
+  if (!registry) {
+    asio::co_spawn(_loop->getIoContext(), coroutine(self), asio::detached);
+    return;
   }
 
+  registry->add(self);
+  asio::co_spawn(_loop->getIoContext(), coroutine(self),
+                 [weak = _registry, id = _id](const std::exception_ptr&) {
+                   if (auto registry = weak.lock()) {
+                     registry->remove(id);
+                   }
+                 });
+}
+
+auto Session::disconnect() -> void {
+  auto self = shared_from_this();
+  _disconnecting.store(true, std::memory_order_relaxed);
+  onDisconnect();
+
   _loop->postTask([this, self] {
+    stopIdleTimer();
+    if (auto registry = _registry.lock()) {
+      registry->remove(_id);
+    }
     if (_socket.is_open()) {
       _socket.close();
     }
   });
 }
 
+auto Session::startIdleTimer() -> void {
+  if (!_socket.is_open()) {
+    return;  // disconnected before the timer could be started
+  }
+
+  auto& wheel = _loop->timingWheel();
+  if (_idle_timer != nullptr) {
+    wheel.refresh(_idle_timer, _idle_timeout);
+    return;
+  }
+
+  // The wheel must not keep the session alive.
+  _idle_timer = wheel.add(_idle_timeout, [weak = weak_from_this()] {
+    if (auto self = weak.lock()) {
+      self->onIdleTimeout();
+    }
+  });
+}
+
+auto Session::stopIdleTimer() -> void {
+  if (_idle_timer != nullptr) {
+    _loop->timingWheel().cancel(std::exchange(_idle_timer, nullptr));
+  }
+}
+
+auto Session::onIdleTimeout() -> void {
+  _idle_timer = nullptr;
+  LOG_DEBUG("Session ID: {}. Idle for {} ms. Disconnect.", _id,
+            _idle_timeout.count());
+  disconnect();
+}
+
+auto Session::onConnect() -> void {
+  // Keep the callbacks alive even if this one replaces them.
+  if (auto callbacks = _callbacks; callbacks && callbacks->connect) {
+    callbacks->connect(shared_from_this());
+  }
+}
+
+auto Session::onRead(Buffer& buffer) -> void {
+  if (_codec) {
+    decodeMessages(buffer);
+    return;
+  }
+
+  if (auto callbacks = _callbacks; callbacks && callbacks->read) {
+    callbacks->read(shared_from_this(), buffer);
+  }
+}
+
+auto Session::decodeMessages(Buffer& buffer) -> void {
+  auto callbacks = _callbacks;
+  auto frame = Codec::Frame{};
+  // The socket stays open until the close posted by disconnect() runs.
+  while (_socket.is_open() &&
+         !_disconnecting.load(std::memory_order_relaxed)) {
+    auto status = _codec->decode(buffer, frame);
+    if (status == Codec::Status::Incomplete) {
+      return;
+    }
+
+    if (status == Codec::Status::Invalid) {
+      LOG_ERROR("Session ID: {}. Invalid frame. Disconnect.", _id);
+      buffer.retrieve(buffer.readableBytes());
+      disconnect();
+      return;
+    }
+
+    if (callbacks && callbacks->message) {
+      callbacks->message(shared_from_this(), frame.message);
+    }
+    buffer.retrieve(frame.size);
+  }
+}
+
+auto Session::onDisconnect() -> void {
+  if (auto callbacks = _callbacks; callbacks && callbacks->disconnect) {
+    callbacks->disconnect(shared_from_this());
+  }
+}
+
 auto Session::connect(const std::string& ip, std::uint16_t port, bool reconnect)
     -> void {
   LOG_DEBUG("Session ID: {}. Remote: {}:{}. Connect.", _id, ip, port);
@@ -93,16 +292,128 @@ auto Session::reconnect(const std::string& ip, std::uint16_t port) -> void {
 }
 
 auto Session::send(const Buffer& buffer) -> void {
-  auto self = shared_from_this();
+  // The caller keeps its buffer, so the readable bytes are copied once.
+  send(BufferSlice{
+      std::string_view{buffer.readBegin(), buffer.readableBytes()}});
+}
+
+auto Session::send(Buffer&& buffer) -> void {
+  send(BufferSlice{std::move(buffer)});
+}
+
+auto Session::send(BufferSlice slice) -> void {
+  LOG_TRACE("Session ID: {}. Remote: {}:{}. Send {} bytes.", _id, _remote_ip,
+            _remote_port, slice.size());
+  enqueue(std::move(slice));
+}
+
+auto Session::sendFile(int fd, std::uint64_t offset, std::size_t length)
+    -> void {
+  LOG_TRACE("Session ID: {}. Remote: {}:{}. Send file {} [{}, +{}).", _id,
+            _remote_ip, _remote_port, fd, offset, length);
+  auto region = FileRegion{fd, offset, length};
+  if (!region.valid()) {
+    return;
+  }
+
+  enqueue(std::move(region));
+}
+
+static auto itemSize(const Session::WriteItem& item) {
+  return std::visit([](const auto& i) { return i.size(); }, item);
+}
+
+auto Session::sendMessage(std::string_view message) -> void {
+  if (!_codec) {
+    send(BufferSlice{message});
+    return;
+  }
+
+  auto frame = _codec->encode(message);
+  if (frame.empty()) {
+    return;
+  }
+
+  send(std::move(frame));
+}
+
+auto Session::sendInLoop(BufferSlice slice) -> void {
   LOG_TRACE("Session ID: {}. Remote: {}:{}. Send {} bytes.", _id, _remote_ip,
-            _remote_port, buffer.readableBytes());
+            _remote_port, slice.size());
+  enqueue(std::move(slice), true);
+}
 
-  {
-    std::scoped_lock lock(_mutex);
-    _unsent_buffers.push(buffer);
+auto Session::enqueue(WriteItem item, bool in_loop) -> void {
+  auto size = itemSize(item);
+  auto pending =
+      _pending_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  _unsent_items.push(NodeCache<WriteNode>::make(std::move(item)));
+
+  if (_high_water_mark.load(std::memory_order_relaxed) <= pending &&
+      !_above_high_water_mark.exchange(true)) {
+    auto self = shared_from_this();
+    _loop->postTask([this, self] { onHighWaterMark(); });
+  }
+
+  // Later sends only enqueue until the loop has flushed everything, so a
+  // burst of small messages costs one task and is batched into one writev.
+  if (_write_scheduled.exchange(true)) {
+    return;
+  }
+
+  if (in_loop) {
+    doWrite();
+    return;
   }
 
-  _loop->postTask([this] { write(); });
+  auto self = shared_from_this();
+  _loop->postTask([this, self] { doWrite(); });
+}
+
+auto Session::onHighWaterMark() -> void {
+  // The queue may have drained again before this task ran.
+  if (!_above_high_water_mark.load()) {
+    return;
+  }
+
+  LOG_DEBUG("Session ID: {}. High water mark reached: {} bytes pending.", _id,
+            pendingBytes());
+  if (auto callbacks = _callbacks; callbacks && callbacks->high_water_mark) {
+    callbacks->high_water_mark(shared_from_this(), pendingBytes());
+  }
+
+  if (auto upstream = _upstream.lock()) {
+    upstream->pauseRead();
+  }
+}
+
+auto Session::releasePending(std::size_t len) -> void {
+  _wrote_since_complete = true;
+  auto pending = _pending_bytes.fetch_sub(len, std::memory_order_relaxed) - len;
+  if (pending <= _low_water_mark.load(std::memory_order_relaxed) &&
+      _above_high_water_mark.exchange(false)) {
+    LOG_DEBUG("Session ID: {}. Drained to low water mark: {} bytes pending.",
+              _id, pending);
+    if (auto upstream = _upstream.lock()) {
+      upstream->resumeRead();
+    }
+  }
+}
+
+auto Session::pauseRead() -> void {
+  auto self = shared_from_this();
+  _loop->postTask([this, self] { _read_paused = true; });
+}
+
+auto Session::resumeRead() -> void {
+  auto self = shared_from_this();
+  _loop->postTask([this, self] {
+    _read_paused = false;
+    if (_read_stopped && _socket.is_open()) {
+      _read_stopped = false;
+      doRead();
+    }
+  });
 }
 
 static auto handleReadError(const auto& ec, auto id) -> int {
@@ -120,36 +431,188 @@ static auto handleReadError(const auto& ec, auto id) -> int {
   return 0;
 }
 
-auto Session::read() -> void {
-  auto self = shared_from_this();
-  if (_read_buffer.empty()) {
-    _read_buffer.resize(Buffer::DEFAULT_SIZE);
+auto Session::doRead() -> void {
+  if (_read_paused) {
+    _read_stopped = true;
+    return;
   }
 
-  socket().async_read_some(
-      asio::buffer(_read_buffer.writeBegin(), _read_buffer.writeableBytes()),
-      [self, this](const auto& ec, auto len) {
-        if (handleReadError(ec, _id) != 0) {
-          if (_reconnect && ec != asio::error::eof) {
-            reconnect(_remote_ip, _remote_port);
-          } else {
-            disconnect();
+  auto self = shared_from_this();
+  socket().async_wait(
+      asio::socket_base::wait_read, [self, this](auto ec) {
+#ifdef ASIO_HAS_IO_URING_AS_DEFAULT
+        // Lent only once there is something to read, so an idle session
+        // holds no registered buffer.
+        if (!ec) {
+          if (auto index = _loop->acquireReadBuffer()) {
+            readRegistered(*index);
+            return;
           }
-
-          return;
         }
-
-        _read_buffer.hasWritten(len);
-        if (_read_buffer.writeableBytes() <= (_read_buffer.capacity() / 4)) {
-          _read_buffer.resize(_read_buffer.capacity() * 2);
-        }
-        if (_read_callback) {
-          _read_callback(shared_from_this(), _read_buffer);
+#endif
+
+        auto len = std::size_t{0};
+        auto& buffer = readTarget();
+        if (!ec) {
+          len = readSome(buffer, ec);
+          if (ec == asio::error::would_block) {
+            doRead();
+            return;
+          }
         }
 
-        read();
+        finishRead(buffer, ec, len);
+      });
+}
+
+#ifdef ASIO_HAS_IO_URING_AS_DEFAULT
+auto Session::readRegistered(std::size_t index) -> void {
+  // A single registered buffer without flags makes asio submit
+  // IORING_OP_READ_FIXED.
+  auto self = shared_from_this();
+  socket().async_read_some(
+      _loop->registeredReadBuffer(index),
+      [self, this, index](const auto& ec, auto len) {
+        auto& buffer = readTarget();
+        if (!ec) {
+          const auto& registered = _loop->registeredReadBuffer(index);
+          buffer.append(static_cast<const char*>(registered.data()), len);
+        }
+        _loop->releaseReadBuffer(index);
+        finishRead(buffer, ec, len);
       });
 }
+#endif
+
+auto Session::finishRead(Buffer& buffer, const asio::error_code& ec,
+                         std::size_t len) -> void {
+  if (handleReadError(ec, _id) != 0) {
+    if (_reconnect && ec != asio::error::eof) {
+      reconnect(_remote_ip, _remote_port);
+    } else {
+      disconnect();
+    }
+
+    return;
+  }
+
+  LOG_TRACE("Session ID: {}. Read {} bytes.", _id, len);
+  if (_idle_timer != nullptr) {
+    _loop->timingWheel().refresh(_idle_timer, _idle_timeout);
+  }
+
+  onRead(buffer);
+  afterRead(buffer);
+  doRead();
+}
+
+auto Session::readTarget() -> Buffer& {
+  // Bytes left over from the last read have to stay in front of new ones.
+  if (_shared_read_buffer && _read_buffer.empty()) {
+    return _loop->sharedReadBuffer();
+  }
+
+  return _read_buffer;
+}
+
+auto Session::readSome(Buffer& buffer, asio::error_code& ec) -> std::size_t {
+  // Read into the free space of the buffer and spill the rest into the loop
+  // scratch in the same readv, so the buffer never has to be grown (and
+  // copied) ahead of time.
+  buffer.ensureWritableBytes(1);
+  auto writable = buffer.writeableBytes();
+  auto scratch = _loop->readScratch();
+  auto buffers = std::array<asio::mutable_buffer, 2>{
+      asio::buffer(buffer.writeBegin(), writable),
+      asio::buffer(scratch.data(), scratch.size())};
+
+  auto len = _socket.read_some(buffers, ec);
+  if (ec) {
+    return 0;
+  }
+
+  if (len <= writable) {
+    buffer.hasWritten(len);
+    return len;
+  }
+
+  buffer.hasWritten(writable);
+  buffer.append(scratch.data(), len - writable);
+  return len;
+}
+
+auto Session::afterRead(Buffer& buffer) -> void {
+  if (&buffer != &_read_buffer) {
+    // Only a partial message the callback could not consume yet moves into
+    // a buffer of the session.
+    if (!buffer.empty()) {
+      _read_buffer.append(buffer.readBegin(), buffer.readableBytes());
+      buffer.retrieve(buffer.readableBytes());
+    }
+    return;
+  }
+
+  if (!_read_buffer.empty()) {
+    return;
+  }
+
+  if (_shared_read_buffer) {
+    _read_buffer.release();
+  } else {
+    _read_buffer.resize(Buffer::DEFAULT_SIZE);  // drop what a burst grew
+  }
+}
+
+auto Session::read(Buffer& buffer, asio::error_code& ec)
+    -> asio::awaitable<std::size_t> {
+  while (true) {
+    co_await _socket.async_wait(asio::socket_base::wait_read,
+                                asio::redirect_error(asio::use_awaitable, ec));
+    if (ec) {
+      co_return 0;
+    }
+
+    auto len = readSome(buffer, ec);
+    if (ec != asio::error::would_block) {
+      co_return len;
+    }
+  }
+}
+
+auto Session::readUntil(Buffer& buffer, std::string_view delim,
+                        asio::error_code& ec, std::size_t max_size)
+    -> asio::awaitable<std::size_t> {
+  // Resume the search where the last one stopped, minus a partial match.
+  std::size_t scanned = 0;
+  while (true) {
+    auto readable =
+        std::string_view{buffer.readBegin(), buffer.readableBytes()};
+    auto pos = readable.find(delim, scanned);
+    if (pos != std::string_view::npos) {
+      co_return pos + delim.size();
+    }
+
+    if (max_size <= readable.size()) {
+      ec = asio::error::message_size;
+      co_return 0;
+    }
+
+    scanned = readable.size() < delim.size()
+                  ? 0
+                  : readable.size() - delim.size() + 1;
+    co_await read(buffer, ec);
+    if (ec) {
+      co_return 0;
+    }
+  }
+}
+
+auto Session::write(BufferSlice slice, asio::error_code& ec)
+    -> asio::awaitable<std::size_t> {
+  co_return co_await asio::async_write(
+      _socket, asio::buffer(slice.data(), slice.size()),
+      asio::redirect_error(asio::use_awaitable, ec));
+}
 
 static auto handleWriteError(const auto& ec, auto id) -> int {
   if (ec) {
@@ -160,38 +623,141 @@ static auto handleWriteError(const auto& ec, auto id) -> int {
   return 0;
 }
 
-auto Session::write() -> void {
-  auto self = shared_from_this();
+auto Session::doWrite() -> void {
+  if (_writing) {
+    return;
+  }
+
+  while (auto* node = _unsent_items.pop()) {
+    if (itemSize(node->_item) != 0) {
+      _sending_items.push_back(std::move(node->_item));
+    }
+    NodeCache<WriteNode>::recycle(node);
+  }
 
-  auto still_writing = !_write_buffer.empty();
-  if (!still_writing) {
-    _write_buffer.resize(
-        Buffer::DEFAULT_SIZE);  // avoid buffer from bigging too much
-    {
-      std::scoped_lock lock(_mutex);
-      while (!_unsent_buffers.empty()) {
-        auto& buffer = _unsent_buffers.front();
-        _write_buffer.append(buffer.readBegin(), buffer.readableBytes());
-        _unsent_buffers.pop();
+  if (_sending_items.empty()) {
+    _write_iovecs.reset();  // idle sessions do not keep the iovec array
+    if (_wrote_since_complete) {
+      _wrote_since_complete = false;
+      if (auto callbacks = _callbacks; callbacks && callbacks->write_complete) {
+        callbacks->write_complete(shared_from_this());
       }
     }
+
+    _write_scheduled.store(false);
+    // A send may have pushed after the drain above but seen the flag still
+    // set. Take the flush back in that case.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!_unsent_items.empty() && !_write_scheduled.exchange(true)) {
+      auto self = shared_from_this();
+      _loop->postTask([this, self] { doWrite(); });
+    }
+    return;
+  }
+
+  if (auto* region = std::get_if<FileRegion>(&_sending_items.front())) {
+    writeFile(*region);
+    return;
+  }
+
+  writeBuffers();
+}
+
+auto Session::writeBuffers() -> void {
+  // Hand the queued buffers up to the next file region to the kernel as one
+  // iovec batch instead of copying them into a single write buffer first.
+  if (!_write_iovecs) {
+    _write_iovecs = std::make_unique_for_overwrite<IoVecs>();
+  }
+
+  auto& iovecs_array = *_write_iovecs;
+  std::size_t iovecs = 0;
+  std::size_t bytes = 0;
+  for (const auto& item : _sending_items) {
+    const auto* slice = std::get_if<BufferSlice>(&item);
+    if (slice == nullptr || iovecs == MAX_WRITE_IOVECS ||
+        MAX_WRITE_BYTES <= bytes) {
+      break;
+    }
+
+    auto len = std::min(slice->size(), MAX_WRITE_BYTES - bytes);
+    iovecs_array[iovecs++] = asio::const_buffer{slice->data(), len};
+    bytes += len;
   }
 
+  _writing = true;
+  countWriteCall();
+  auto self = shared_from_this();
   socket().async_write_some(
-      asio::buffer(_write_buffer.readBegin(), _write_buffer.readableBytes()),
+      std::span{iovecs_array.data(), iovecs},
       [self, this](const auto& ec, auto len) {
+        _writing = false;
         if (handleWriteError(ec, _id) != 0) {
           disconnect();
           return;
         }
 
-        _write_buffer.retrieve(len);
-        if (_write_buffer.empty()) {
-          return;
-        }
-
-        write();
+        consumeSent(len);
+        doWrite();
       });
 }
 
+auto Session::writeFile(FileRegion& region) -> void {
+  auto ec = asio::error_code{};
+  countWriteCall();
+  auto sent = region.sendTo(_socket.native_handle(), ec);
+  if (0 < sent) {
+    releasePending(sent);
+  }
+
+  if (ec == asio::error::would_block) {
+    _writing = true;
+    auto self = shared_from_this();
+    socket().async_wait(asio::socket_base::wait_write,
+                        [self, this](const auto& wait_ec) {
+                          _writing = false;
+                          if (handleWriteError(wait_ec, _id) != 0) {
+                            disconnect();
+                            return;
+                          }
+
+                          doWrite();
+                        });
+    return;
+  }
+
+  if (handleWriteError(ec, _id) != 0) {
+    disconnect();
+    return;
+  }
+
+  if (region.empty()) {
+    _sending_items.pop_front();
+  }
+
+  // Let other handlers of the loop run between two chunks of a big file.
+  _writing = true;
+  auto self = shared_from_this();
+  asio::post(_loop->getIoContext(), [self, this] {
+    _writing = false;
+    doWrite();
+  });
+}
+
+auto Session::consumeSent(std::size_t len) -> void {
+  releasePending(len);
+
+  // A partial write may stop anywhere, including inside a buffer.
+  while (0 < len && !_sending_items.empty()) {
+    auto& slice = std::get<BufferSlice>(_sending_items.front());
+    if (len < slice.size()) {
+      slice.removePrefix(len);
+      return;
+    }
+
+    len -= slice.size();
+    _sending_items.pop_front();
+  }
+}
+
 }  // namespace fz::net
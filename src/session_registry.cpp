@@ -0,0 +1,155 @@
+#include "fz/net/session_registry.h"
+
+#include <asio.hpp>
+#include <utility>
+
+#include "fz/net/session.h"
+
+namespace fz::net {
+
+SessionRegistry::SessionRegistry(
+    const std::vector<std::shared_ptr<Loop>>& loops) {
+  _shards.reserve(loops.size());
+  for (const auto& loop : loops) {
+    _shard_index.emplace(loop->id(), _shards.size());
+    _shards.push_back(std::make_unique<Shard>());
+    _shards.back()->loop = loop;
+  }
+}
+
+auto SessionRegistry::shardOf(std::uint64_t session_id) const -> Shard* {
+  auto it = _shard_index.find(Loop::loopIdOf(session_id));
+  return it == _shard_index.end() ? nullptr : _shards[it->second].get();
+}
+
+auto SessionRegistry::keyShardOf(const std::string& key) const -> Shard& {
+  return *_shards[std::hash<std::string>{}(key) % _shards.size()];
+}
+
+auto SessionRegistry::add(const std::shared_ptr<Session>& session) -> void {
+  auto* shard = shardOf(session->id());
+  if (shard == nullptr) {
+    return;  // not one of our loops
+  }
+
+  asio::dispatch(shard->loop->getIoContext(), [shard, session] {
+    shard->sessions.insert_or_assign(session->id(), Entry{session, {}});
+    shard->count.store(shard->sessions.size(), std::memory_order_relaxed);
+  });
+}
+
+auto SessionRegistry::remove(std::uint64_t id) -> void {
+  auto* shard = shardOf(id);
+  if (shard == nullptr) {
+    return;
+  }
+
+  asio::dispatch(shard->loop->getIoContext(), [this, shard, id] {
+    auto it = shard->sessions.find(id);
+    if (it == shard->sessions.end()) {
+      return;
+    }
+
+    auto key = std::move(it->second.key);
+    shard->sessions.erase(it);
+    shard->count.store(shard->sessions.size(), std::memory_order_relaxed);
+    if (!key.empty()) {
+      unbind(key, id);
+    }
+  });
+}
+
+auto SessionRegistry::find(std::uint64_t id, Visitor visitor) -> void {
+  auto* shard = shardOf(id);
+  if (shard == nullptr) {
+    visitor(nullptr);
+    return;
+  }
+
+  asio::dispatch(shard->loop->getIoContext(),
+                 [shard, id, visitor = std::move(visitor)] {
+                   auto it = shard->sessions.find(id);
+                   visitor(it == shard->sessions.end() ? nullptr
+                                                       : it->second.session);
+                 });
+}
+
+auto SessionRegistry::bind(const std::shared_ptr<Session>& session,
+                           std::string key) -> void {
+  auto id = session->id();
+  auto* shard = shardOf(id);
+  if (shard == nullptr || key.empty()) {
+    return;
+  }
+
+  asio::dispatch(
+      shard->loop->getIoContext(), [this, shard, id, key = std::move(key)] {
+        auto it = shard->sessions.find(id);
+        if (it == shard->sessions.end() || it->second.key == key) {
+          return;
+        }
+
+        if (!it->second.key.empty()) {
+          unbind(it->second.key, id);
+        }
+        it->second.key = key;
+        auto& key_shard = keyShardOf(key);
+        asio::dispatch(key_shard.loop->getIoContext(), [&key_shard, id, key] {
+          key_shard.keys.insert_or_assign(key, id);
+        });
+      });
+}
+
+auto SessionRegistry::unbind(const std::string& key, std::uint64_t id)
+    -> void {
+  auto& key_shard = keyShardOf(key);
+  asio::dispatch(key_shard.loop->getIoContext(), [&key_shard, id, key] {
+    // The key may have moved on to another session meanwhile.
+    if (auto it = key_shard.keys.find(key);
+        it != key_shard.keys.end() && it->second == id) {
+      key_shard.keys.erase(it);
+    }
+  });
+}
+
+auto SessionRegistry::findByKey(const std::string& key, Visitor visitor)
+    -> void {
+  auto& key_shard = keyShardOf(key);
+  asio::dispatch(key_shard.loop->getIoContext(),
+                 [this, &key_shard, key, visitor = std::move(visitor)] {
+                   auto it = key_shard.keys.find(key);
+                   if (it == key_shard.keys.end()) {
+                     visitor(nullptr);
+                     return;
+                   }
+                   find(it->second, visitor);
+                 });
+}
+
+auto SessionRegistry::forEach(const Visitor& visitor) -> void {
+  for (auto& shard : _shards) {
+    asio::post(shard->loop->getIoContext(), [&shard = *shard, visitor] {
+      for (const auto& [id, entry] : shard.sessions) {
+        visitor(entry.session);
+      }
+    });
+  }
+}
+
+auto SessionRegistry::clear() -> void {
+  for (auto& shard : _shards) {
+    shard->sessions.clear();
+    shard->keys.clear();
+    shard->count.store(0, std::memory_order_relaxed);
+  }
+}
+
+auto SessionRegistry::size() const -> std::size_t {
+  auto total = std::size_t{0};
+  for (const auto& shard : _shards) {
+    total += shard->count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+}  // namespace fz::net
@@ -1,13 +1,17 @@
 #include "fz/net/tcp_server.h"
 
+#include <utility>
+
 #include "fz/net/loop_pool.h"
 
 namespace fz::net {
 
 TcpServer::TcpServer(std::size_t loop_pool_size, std::string_view ip,
-                     uint16_t port)
-    : _loop_pool{std::make_shared<LoopPool>(loop_pool_size)},
-      _acceptor{_loop_pool->findNext(), ip, port} {}
+                     uint16_t port, LoopPoolOptions options)
+    : _loop_pool{std::make_shared<LoopPool>(loop_pool_size,
+                                            std::move(options))},
+      _acceptor{_loop_pool->findNext(), ip, port},
+      _registry{std::make_shared<SessionRegistry>(_loop_pool->loops())} {}
 
 auto TcpServer::start() -> void {
   _loop_pool->start();
@@ -17,6 +21,28 @@ auto TcpServer::start() -> void {
 auto TcpServer::stop() -> void {
   _acceptor.stop();
   _loop_pool->stop();
+  // Entries keep their sessions alive.
+  _registry->clear();
+}
+
+auto TcpServer::broadcast(BufferSlice payload, SessionFilter filter) -> void {
+  if (payload.empty()) {
+    return;
+  }
+
+  _registry->forEach([payload = std::move(payload),
+                      filter = std::move(filter)](const auto& session) {
+    if (!filter || filter(session)) {
+      session->sendInLoop(payload);
+    }
+  });
+}
+
+auto TcpServer::broadcastMessage(std::string_view message,
+                                 SessionFilter filter) -> void {
+  auto payload = _codec ? BufferSlice{_codec->encode(message)}
+                        : BufferSlice{message};
+  broadcast(std::move(payload), std::move(filter));
 }
 
 }  // namespace fz::net
@@ -0,0 +1,150 @@
+#include "fz/net/timing_wheel.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace fz::net {
+
+// Slot of entries taken out of the wheel and waiting for their callback.
+constexpr static auto FIRING_SLOT = std::numeric_limits<std::size_t>::max();
+
+TimingWheel::TimingWheel(asio::io_context& io_context, Duration tick,
+                         std::size_t slots)
+    : _timer{io_context},
+      _tick{std::max(tick, Duration{1})},
+      _slots(std::max<std::size_t>(slots, 1), nullptr),
+      _origin{std::chrono::steady_clock::now()} {}
+
+TimingWheel::~TimingWheel() {
+  for (auto* entry : _slots) {
+    while (entry != nullptr) {
+      delete std::exchange(entry, entry->_next);
+    }
+  }
+}
+
+auto TimingWheel::add(Duration timeout, Callback callback) -> TimerId {
+  if (_size == 0) {
+    // Nothing was waiting, so the wheel may have stood still for a while.
+    _current_tick = std::max(_current_tick, elapsedTicks());
+  }
+
+  auto* entry = new Entry{};
+  entry->_deadline = _current_tick + ticks(timeout);
+  entry->_callback = std::move(callback);
+  link(entry);
+  ++_size;
+
+  if (!_ticking) {
+    schedule();
+  }
+
+  return entry;
+}
+
+auto TimingWheel::cancel(TimerId id) -> void {
+  if (id->_slot == FIRING_SLOT) {
+    // Expired in the batch being run right now; the batch frees it.
+    id->_callback = nullptr;
+    return;
+  }
+
+  unlink(id);
+  --_size;
+  delete id;
+}
+
+auto TimingWheel::ticks(Duration timeout) const -> std::uint64_t {
+  auto count = (std::max(timeout, Duration{}) + _tick - Duration{1}) / _tick;
+  return std::max<std::uint64_t>(static_cast<std::uint64_t>(count), 1);
+}
+
+auto TimingWheel::elapsedTicks() const -> std::uint64_t {
+  return static_cast<std::uint64_t>(
+      (std::chrono::steady_clock::now() - _origin) / _tick);
+}
+
+auto TimingWheel::link(Entry* entry) -> void {
+  entry->_slot = entry->_deadline % _slots.size();
+  entry->_prev = nullptr;
+  entry->_next = _slots[entry->_slot];
+  if (entry->_next != nullptr) {
+    entry->_next->_prev = entry;
+  }
+  _slots[entry->_slot] = entry;
+}
+
+auto TimingWheel::unlink(Entry* entry) -> void {
+  if (entry->_prev != nullptr) {
+    entry->_prev->_next = entry->_next;
+  } else {
+    _slots[entry->_slot] = entry->_next;
+  }
+
+  if (entry->_next != nullptr) {
+    entry->_next->_prev = entry->_prev;
+  }
+}
+
+auto TimingWheel::schedule() -> void {
+  _ticking = true;
+  _timer.expires_at(_origin + _tick * static_cast<Duration::rep>(
+                                          _current_tick + 1));
+  _timer.async_wait([this](const auto& ec) {
+    _ticking = false;
+    if (ec) {
+      return;
+    }
+
+    advance();
+  });
+}
+
+auto TimingWheel::advance() -> void {
+  auto target = elapsedTicks();
+  // After a long stall one revolution visits every slot; later deadlines are
+  // compared against the current tick anyway.
+  if (_current_tick + _slots.size() < target) {
+    _current_tick = target - _slots.size();
+  }
+
+  while (_current_tick < target) {
+    ++_current_tick;
+    expire(_current_tick % _slots.size());
+  }
+
+  if (0 < _size && !_ticking) {
+    schedule();
+  }
+}
+
+auto TimingWheel::expire(std::size_t slot) -> void {
+  auto* entry = std::exchange(_slots[slot], nullptr);
+  while (entry != nullptr) {
+    auto* next = entry->_next;
+    if (_current_tick < entry->_deadline) {
+      link(entry);  // refreshed, or due in a later revolution
+    } else {
+      entry->_slot = FIRING_SLOT;
+      _expired.push_back(entry);
+      --_size;
+    }
+    entry = next;
+  }
+
+  // Callbacks may cancel timers of the same batch, so nothing is freed
+  // before all of them have run.
+  for (auto* fired : _expired) {
+    if (auto callback = std::exchange(fired->_callback, nullptr)) {
+      callback();
+    }
+  }
+
+  for (auto* fired : _expired) {
+    delete fired;
+  }
+  _expired.clear();
+}
+
+}  // namespace fz::net
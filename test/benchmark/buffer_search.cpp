@@ -0,0 +1,119 @@
+// Buffer::findCRLF / findAnyOf against std::string_view::find.
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "fz/net/common/buffer.h"
+#include "fz/net/common/search.h"
+
+template <typename F>
+static auto measure(std::string_view name, std::size_t bytes,
+                    std::size_t rounds, F&& f) {
+  std::size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; ++i) {
+    found += f();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  std::cout << "  " << name << ": "
+            << static_cast<double>(bytes * rounds) / elapsed / 1e9
+            << " GB/s (" << found / rounds << " hits/round)\n";
+}
+
+static auto makeHeaders(std::size_t size) {
+  auto data = std::string{};
+  while (data.size() < size) {
+    data += "X-Forwarded-For: 203.0.113.195, 70.41.3.18, 150.172.238.178\r\n";
+    data += "Accept-Encoding: gzip, deflate, br\r\n";
+  }
+  data.resize(size);
+  return data;
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t size = 64 * 1024;
+  std::size_t rounds = 20'000;
+  if (1 < argc) {
+    size = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    rounds = std::stoul(argv[2]);
+  }
+
+  std::cout << "implementation: " << fz::net::common::searchImplName()
+            << ", buffer: " << size << " bytes\n";
+
+  auto headers = makeHeaders(size);
+  auto buffer = fz::net::Buffer{};
+  buffer.append(headers);
+  auto view = std::string_view{buffer.readBegin(), buffer.readableBytes()};
+
+  std::cout << "every CRLF in header lines\n";
+  measure("string_view::find", size, rounds, [&] {
+    std::size_t n = 0;
+    for (auto pos = view.find("\r\n"); pos != std::string_view::npos;
+         pos = view.find("\r\n", pos + 2)) {
+      ++n;
+    }
+    return n;
+  });
+  measure("Buffer::findCRLF", size, rounds, [&] {
+    std::size_t n = 0;
+    for (auto pos = buffer.findCRLF(); pos != fz::net::Buffer::npos;
+         pos = buffer.findCRLF(pos + 2)) {
+      ++n;
+    }
+    return n;
+  });
+
+  auto line = fz::net::Buffer{};
+  line.append(std::string(size - 2, 'a'));
+  line.append("\r\n");
+  auto line_view = std::string_view{line.readBegin(), line.readableBytes()};
+
+  std::cout << "one CRLF at the end of a long line\n";
+  measure("string_view::find", size, rounds,
+          [&] { return line_view.find("\r\n") != std::string_view::npos; });
+  measure("Buffer::findCRLF", size, rounds,
+          [&] { return line.findCRLF() != fz::net::Buffer::npos; });
+
+  std::cout << "first of \":\\r\\n\" in a long line\n";
+  measure("string_view::find_first_of", size, rounds, [&] {
+    return line_view.find_first_of(":\r\n") != std::string_view::npos;
+  });
+  measure("Buffer::findAnyOf", size, rounds,
+          [&] { return line.findAnyOf(":\r\n") != fz::net::Buffer::npos; });
+
+  // A long line arriving in 512-byte reads. Searching from the start of the
+  // unparsed data on every read is quadratic; resuming is linear.
+  constexpr std::size_t READ_SIZE = 512;
+  std::cout << "long line arriving in " << READ_SIZE << "-byte reads\n";
+  measure("string_view::find rescan", size, rounds / 100, [&] {
+    auto n = std::size_t{0};
+    for (std::size_t end = READ_SIZE; end <= size; end += READ_SIZE) {
+      n += line_view.substr(0, end).find("\r\n") != std::string_view::npos;
+    }
+    return n;
+  });
+  measure("Buffer::findCRLF resume", size, rounds / 100, [&] {
+    auto n = std::size_t{0};
+    auto partial = fz::net::Buffer{};
+    auto resume = std::size_t{0};
+    for (std::size_t begin = 0; begin < size; begin += READ_SIZE) {
+      partial.append(line_view.substr(begin, READ_SIZE));
+      if (partial.findCRLF(resume) != fz::net::Buffer::npos) {
+        ++n;
+        break;
+      }
+      resume = partial.readableBytes() - 1;
+    }
+    return n;
+  });
+
+  return 0;
+}
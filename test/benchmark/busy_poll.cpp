@@ -0,0 +1,95 @@
+// Echo round-trip latency, p50 and p99, of one connection to a server whose
+// loop sleeps in epoll when idle and of one that busy polls for a while
+// first. The client times every round trip. Busy polling pays off when the
+// loop has a core to itself: on a machine with fewer cores than the loop
+// plus the client, the spinning loop competes with the client for the CPU
+// and the numbers say more about the scheduler than the loop.
+
+#include <algorithm>
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/loop.h"
+#include "fz/net/loop_pool.h"
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+using Clock = std::chrono::steady_clock;
+
+static auto run(std::string_view name, std::chrono::microseconds busy_poll,
+                std::uint16_t port, std::size_t round_trips,
+                std::size_t message_size) {
+  auto options = fz::net::LoopPoolOptions{};
+  options.busy_poll = busy_poll;
+  fz::net::TcpServer server{1, "127.0.0.1", port, options};
+  server.setNewSessionCallback<fz::net::Session>();
+  server.setReadCallback([](const auto& session, auto& buffer) {
+    session->send(std::move(buffer));
+  });
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto nanos = std::vector<std::int64_t>{};
+  nanos.reserve(round_trips);
+  {
+    asio::io_context io_context;
+    auto socket = asio::ip::tcp::socket{io_context};
+    socket.connect({asio::ip::make_address("127.0.0.1"), port});
+    socket.set_option(asio::ip::tcp::no_delay(true));
+    auto message = std::string(message_size, 'x');
+    auto reply = std::string(message_size, '\0');
+    for (std::size_t n = 0; n < round_trips; ++n) {
+      auto start = Clock::now();
+      asio::write(socket, asio::buffer(message));
+      asio::read(socket, asio::buffer(reply));
+      nanos.push_back((Clock::now() - start).count());
+    }
+  }
+  auto stats = server.loops().front()->busyPollStats();
+  server.stop();
+
+  std::sort(nanos.begin(), nanos.end());
+  auto at = [&](double q) {
+    auto i = static_cast<std::size_t>(q * static_cast<double>(nanos.size()));
+    return static_cast<double>(nanos[std::min(i, nanos.size() - 1)]) / 1e3;
+  };
+  std::cout << "  " << name << ": p50 " << at(0.5) << " us, p99 "
+            << at(0.99) << " us\n";
+  if (0 < busy_poll.count()) {
+    std::cout << "    polls " << stats.polls << ", useful "
+              << stats.usefulRatio() * 100 << "%, spinning "
+              << static_cast<double>(stats.spin_nanos) / 1e6
+              << " ms, blocked " << stats.blocks << " time(s)\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t round_trips = 50'000;
+  std::size_t message_size = 64;
+  auto budget = std::chrono::microseconds(50);
+  if (1 < argc) {
+    round_trips = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    message_size = std::stoul(argv[2]);
+  }
+  if (3 < argc) {
+    budget = std::chrono::microseconds(std::stol(argv[3]));
+  }
+
+  std::cout << round_trips << " round trip(s) x " << message_size
+            << " bytes, " << std::thread::hardware_concurrency()
+            << " CPU(s)\n";
+
+  run("epoll wait", {}, 2331, round_trips, message_size);
+  run("busy poll " + std::to_string(budget.count()) + " us", budget, 2332,
+      round_trips, message_size);
+
+  return 0;
+}
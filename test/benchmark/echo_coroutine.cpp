@@ -0,0 +1,103 @@
+// Echo round trips per second through a TcpServer driven by the read
+// callback and through one driven by a coroutine per session (co_await
+// read/write). Every client connection runs a blocking ping-pong on its own
+// thread.
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+static auto run(std::string_view name, std::uint16_t port,
+                std::size_t connections, std::size_t round_trips,
+                std::size_t message_size) {
+  auto threads = std::vector<std::thread>{};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < connections; ++i) {
+    threads.emplace_back([=] {
+      asio::io_context io_context;
+      auto socket = asio::ip::tcp::socket{io_context};
+      socket.connect({asio::ip::make_address("127.0.0.1"), port});
+      socket.set_option(asio::ip::tcp::no_delay(true));
+      auto message = std::string(message_size, 'x');
+      auto reply = std::string(message_size, '\0');
+      for (std::size_t n = 0; n < round_trips; ++n) {
+        asio::write(socket, asio::buffer(message));
+        asio::read(socket, asio::buffer(reply));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(connections * round_trips) / elapsed / 1e3
+            << " k round trips/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t connections = 8;
+  std::size_t round_trips = 50'000;
+  std::size_t message_size = 64;
+  std::size_t loops = 2;
+  if (1 < argc) {
+    connections = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    round_trips = std::stoul(argv[2]);
+  }
+  if (3 < argc) {
+    message_size = std::stoul(argv[3]);
+  }
+
+  std::cout << connections << " connection(s), " << round_trips << " x "
+            << message_size << " bytes, " << loops << " loop(s)\n";
+
+  {
+    fz::net::TcpServer server{loops, "127.0.0.1", 2317};
+    server.setNewSessionCallback<fz::net::Session>();
+    server.setReadCallback([](const auto& session, auto& buffer) {
+      session->send(std::move(buffer));
+    });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    run("callback", 2317, connections, round_trips, message_size);
+    server.stop();
+  }
+
+  {
+    fz::net::TcpServer server{loops, "127.0.0.1", 2318};
+    server.setNewSessionCallback<fz::net::Session>();
+    server.setSessionCoroutine(
+        [](std::shared_ptr<fz::net::Session> session)
+            -> asio::awaitable<void> {
+          auto buffer = fz::net::Buffer{0};
+          auto ec = asio::error_code{};
+          while (!ec) {
+            co_await session->read(buffer, ec);
+            if (!ec) {
+              co_await session->write(fz::net::BufferSlice{std::move(buffer)},
+                                      ec);
+            }
+          }
+        });
+    server.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    run("coroutine", 2318, connections, round_trips, message_size);
+    server.stop();
+  }
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+// Fan-out messages delivered per second when the same message goes to every
+// connected session: once by sending a copy to each session from the caller
+// thread, and once with TcpServer::broadcast(), which shares one payload and
+// posts one task per loop. All connections are read by one client thread.
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/common/buffer.h"
+#include "fz/net/common/buffer_slice.h"
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+// Connects connections sockets and counts what arrives on all of them.
+class Clients {
+ public:
+  Clients(std::uint16_t port, std::size_t connections) {
+    for (std::size_t i = 0; i < connections; ++i) {
+      auto& socket = _sockets.emplace_back(_io_context);
+      socket.connect({asio::ip::make_address("127.0.0.1"), port});
+    }
+    _buffers.resize(connections, std::vector<char>(64 * 1024));
+    for (std::size_t i = 0; i < connections; ++i) {
+      read(i);
+    }
+    _thread = std::thread([this] { _io_context.run(); });
+  }
+
+  ~Clients() {
+    _io_context.stop();
+    _thread.join();
+  }
+
+  Clients(const Clients&) = delete;
+
+  auto operator=(const Clients&) -> Clients& = delete;
+
+  auto waitFor(std::size_t bytes) const {
+    while (_received.load(std::memory_order_relaxed) < bytes) {
+      std::this_thread::yield();
+    }
+  }
+
+ private:
+  auto read(std::size_t i) -> void {
+    _sockets[i].async_read_some(
+        asio::buffer(_buffers[i]), [this, i](const auto& ec, auto len) {
+          if (ec) {
+            return;
+          }
+          _received.fetch_add(len, std::memory_order_relaxed);
+          read(i);
+        });
+  }
+
+ private:
+  asio::io_context _io_context;
+  std::vector<asio::ip::tcp::socket> _sockets;
+  std::vector<std::vector<char>> _buffers;
+  std::atomic<std::size_t> _received{};
+  std::thread _thread;
+};
+
+static auto run(std::string_view name, std::size_t loops, std::uint16_t port,
+                std::size_t connections, std::size_t messages,
+                std::size_t message_size, bool broadcast) {
+  fz::net::TcpServer server{loops, "127.0.0.1", port};
+  server.setNewSessionCallback<fz::net::Session>();
+  std::mutex mutex;
+  auto sessions = std::vector<std::shared_ptr<fz::net::Session>>{};
+  server.setConnectCallback([&](const auto& session) {
+    auto lock = std::lock_guard{mutex};
+    sessions.push_back(session);
+  });
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto clients = Clients{port, connections};
+  while (server.sessionCount() < connections) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  auto message = std::string(message_size, 'x');
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t n = 0; n < messages; ++n) {
+    if (broadcast) {
+      server.broadcast(fz::net::BufferSlice{message});
+      continue;
+    }
+
+    auto lock = std::lock_guard{mutex};
+    for (const auto& session : sessions) {
+      auto buffer = fz::net::Buffer{};
+      buffer.append(message);
+      session->send(std::move(buffer));
+    }
+  }
+  clients.waitFor(connections * messages * message_size);
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(connections * messages) / elapsed / 1e6
+            << " M messages/s\n";
+
+  sessions.clear();
+  server.stop();
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t connections = 500;
+  std::size_t messages = 2'000;
+  std::size_t message_size = 64;
+  std::size_t loops = 2;
+  if (1 < argc) {
+    connections = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    messages = std::stoul(argv[2]);
+  }
+  if (3 < argc) {
+    message_size = std::stoul(argv[3]);
+  }
+
+  std::cout << connections << " connection(s), " << messages << " x "
+            << message_size << " bytes, " << loops << " loop(s)\n";
+
+  run("copy per session", loops, 2319, connections, messages, message_size,
+      false);
+  run("broadcast", loops, 2320, connections, messages, message_size, true);
+
+  return 0;
+}
@@ -0,0 +1,208 @@
+// Echo and HTTP keep-alive throughput of a one-loop server, with the CPU
+// time, context switches and syscalls its loop thread spends per request.
+// The backend is chosen at build time, so build the benchmark once as is
+// and once with -DFZ_NET_USE_IO_URING=ON and compare the two runs.
+// Syscalls are counted with a perf event on the raw_syscalls:sys_enter
+// tracepoint of the loop thread, which needs tracefs mounted and root or
+// CAP_PERFMON; without them the column is left out.
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "fz/net/loop.h"
+#include "fz/net/loop_pool.h"
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+constexpr std::string_view HTTP_REQUEST =
+    "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+constexpr std::string_view HTTP_RESPONSE =
+    "HTTP/1.1 200 OK\r\nServer: fz\r\nContent-Length: 11\r\n"
+    "Content-Type: text/plain\r\n\r\nhello world";
+
+struct Usage {
+  double user_us{};
+  double sys_us{};
+  long context_switches{};
+  std::uint64_t syscalls{};
+};
+
+static auto toMicros(const timeval& tv) {
+  return static_cast<double>(tv.tv_sec) * 1e6 +
+         static_cast<double>(tv.tv_usec);
+}
+
+// Counter of the syscalls the calling thread enters, -1 if the kernel does
+// not offer one.
+static auto openSyscallCounter() -> int {
+  auto id = std::uint64_t{};
+  for (const auto* path :
+       {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"}) {
+    if (auto file = std::ifstream{path}; file >> id) {
+      break;
+    }
+  }
+  if (id == 0) {
+    return -1;
+  }
+
+  auto attr = perf_event_attr{};
+  attr.type = PERF_TYPE_TRACEPOINT;
+  attr.size = sizeof(attr);
+  attr.config = id;
+  return static_cast<int>(
+      syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+// Opened on the loop thread, so it counts that thread only.
+static auto loopSyscallCounter(fz::net::Loop& loop) {
+  auto promise = std::promise<int>{};
+  auto future = promise.get_future();
+  loop.postTask([promise = std::move(promise)]() mutable {
+    promise.set_value(openSyscallCounter());
+  });
+  return future.get();
+}
+
+// Resource usage of the loop's own thread, read on that thread.
+static auto loopUsage(fz::net::Loop& loop, int syscall_counter) {
+  auto promise = std::promise<Usage>{};
+  auto future = promise.get_future();
+  loop.postTask([promise = std::move(promise), syscall_counter]() mutable {
+    auto resources = rusage{};
+    getrusage(RUSAGE_THREAD, &resources);
+    auto usage = Usage{toMicros(resources.ru_utime),
+                       toMicros(resources.ru_stime),
+                       resources.ru_nvcsw + resources.ru_nivcsw};
+    if (0 <= syscall_counter &&
+        ::read(syscall_counter, &usage.syscalls, sizeof(usage.syscalls)) !=
+            sizeof(usage.syscalls)) {
+      usage.syscalls = 0;
+    }
+    promise.set_value(usage);
+  });
+  return future.get();
+}
+
+static auto serveEcho(fz::net::TcpServer& server) {
+  server.setReadCallback([](const auto& session, auto& buffer) {
+    session->send(std::move(buffer));
+  });
+}
+
+// Answers every complete request in the buffer; enough parsing for
+// pipelined GETs without a body.
+static auto serveHttp(fz::net::TcpServer& server) {
+  server.setReadCallback([](const auto& session, auto& buffer) {
+    auto data = std::string_view{buffer.readBegin(), buffer.readableBytes()};
+    auto consumed = std::size_t{0};
+    auto responses = fz::net::Buffer{};
+    while (true) {
+      auto end = data.find("\r\n\r\n", consumed);
+      if (end == std::string_view::npos) {
+        break;
+      }
+      consumed = end + 4;
+      responses.append(HTTP_RESPONSE);
+    }
+    buffer.retrieve(consumed);
+    if (!responses.empty()) {
+      session->send(std::move(responses));
+    }
+  });
+}
+
+static auto run(std::string_view name, bool http, std::uint16_t port,
+                std::size_t connections, std::size_t requests) {
+  fz::net::TcpServer server{1, "127.0.0.1", port};
+  server.setNewSessionCallback<fz::net::Session>();
+  if (http) {
+    serveHttp(server);
+  } else {
+    serveEcho(server);
+  }
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto& loop = *server.loops().front();
+  auto syscall_counter = loopSyscallCounter(loop);
+  auto before = loopUsage(loop, syscall_counter);
+  auto threads = std::vector<std::thread>{};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < connections; ++i) {
+    threads.emplace_back([=] {
+      asio::io_context io_context;
+      auto socket = asio::ip::tcp::socket{io_context};
+      socket.connect({asio::ip::make_address("127.0.0.1"), port});
+      socket.set_option(asio::ip::tcp::no_delay(true));
+      auto request = http ? std::string{HTTP_REQUEST} : std::string(64, 'x');
+      auto reply =
+          std::string(http ? HTTP_RESPONSE.size() : request.size(), '\0');
+      for (std::size_t n = 0; n < requests; ++n) {
+        asio::write(socket, asio::buffer(request));
+        asio::read(socket, asio::buffer(reply));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  auto after = loopUsage(loop, syscall_counter);
+  server.stop();
+  if (0 <= syscall_counter) {
+    ::close(syscall_counter);
+  }
+
+  auto total = static_cast<double>(connections * requests);
+  std::cout << "  " << name << ": " << total / elapsed / 1e3
+            << " k requests/s; loop thread per request: user "
+            << (after.user_us - before.user_us) / total << " us, sys "
+            << (after.sys_us - before.sys_us) / total << " us, "
+            << static_cast<double>(after.context_switches -
+                                   before.context_switches) /
+                   total
+            << " context switches";
+  if (0 <= syscall_counter) {
+    std::cout << ", "
+              << static_cast<double>(after.syscalls - before.syscalls) / total
+              << " syscalls";
+  }
+  std::cout << '\n';
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t connections = 8;
+  std::size_t requests = 20'000;
+  if (1 < argc) {
+    connections = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    requests = std::stoul(argv[2]);
+  }
+
+  std::cout << fz::net::Loop::backendName() << ", " << connections
+            << " connection(s) x " << requests << " request(s)\n";
+
+  run("echo", false, 2341, connections, requests);
+  run("http", true, 2342, connections, requests);
+
+  return 0;
+}
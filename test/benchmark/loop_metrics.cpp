@@ -0,0 +1,70 @@
+// Cost of the loop metrics per posted task, and what they report. Tasks are
+// posted from one thread with metrics off and then on; the difference in
+// time per task is the recording overhead. Needs a build with
+// FZ_NET_ENABLE_LOOP_METRICS.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "fz/net/common/histogram.h"
+#include "fz/net/loop.h"
+
+static auto run(std::size_t tasks, bool metrics) -> double {
+  auto loop = fz::net::Loop{};
+  loop.setMetricsEnabled(metrics);
+  loop.start();
+  std::atomic<std::size_t> done{};
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < tasks; ++i) {
+    loop.postTask([&done] { done.fetch_add(1, std::memory_order_release); });
+  }
+  while (done.load(std::memory_order_acquire) < tasks) {
+    std::this_thread::yield();
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  loop.stop();
+
+  if (metrics) {
+    auto print = [](std::string_view name, const auto& h) {
+      std::cout << "  " << name << ": n=" << h.count << " mean=" << h.mean()
+                << " p50<=" << h.percentile(0.5)
+                << " p99<=" << h.percentile(0.99) << " max=" << h.max
+                << " ns\n";
+    };
+    auto m = loop.metrics();
+    print("enqueue delay", m.enqueue_delay);
+    print("handler time", m.handler_time);
+    print("iteration time", m.iteration_time);
+  }
+
+  return elapsed / static_cast<double>(tasks);
+}
+
+int main(int argc, char* argv[]) {
+  if (!fz::net::Loop::METRICS_SUPPORTED) {
+    std::cout << "built without FZ_NET_ENABLE_LOOP_METRICS\n";
+    return 0;
+  }
+
+  std::size_t tasks = 2'000'000;
+  if (1 < argc) {
+    tasks = std::stoul(argv[1]);
+  }
+
+  std::cout << tasks << " task(s)\n";
+  auto off = run(tasks, false);
+  auto on = run(tasks, true);
+  std::cout << "  off: " << off << " ns/task, on: " << on
+            << " ns/task, overhead: " << on - off << " ns/task\n";
+
+  return 0;
+}
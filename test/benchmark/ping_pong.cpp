@@ -0,0 +1,88 @@
+// Echo round trips per second with the loops' io_context built with asio's
+// default concurrency hint, with a hint of one thread, and with the
+// library's default that also drops the per-socket locks. Every client
+// connection runs a blocking ping-pong on its own thread.
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/loop.h"
+#include "fz/net/loop_pool.h"
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+static auto run(std::string_view name, int concurrency_hint,
+                std::uint16_t port, std::size_t loops,
+                std::size_t connections, std::size_t round_trips,
+                std::size_t message_size) {
+  auto options = fz::net::LoopPoolOptions{};
+  options.concurrency_hint = concurrency_hint;
+  fz::net::TcpServer server{loops, "127.0.0.1", port, options};
+  server.setNewSessionCallback<fz::net::Session>();
+  server.setReadCallback([](const auto& session, auto& buffer) {
+    session->send(std::move(buffer));
+  });
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto threads = std::vector<std::thread>{};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < connections; ++i) {
+    threads.emplace_back([=] {
+      asio::io_context io_context;
+      auto socket = asio::ip::tcp::socket{io_context};
+      socket.connect({asio::ip::make_address("127.0.0.1"), port});
+      socket.set_option(asio::ip::tcp::no_delay(true));
+      auto message = std::string(message_size, 'x');
+      auto reply = std::string(message_size, '\0');
+      for (std::size_t n = 0; n < round_trips; ++n) {
+        asio::write(socket, asio::buffer(message));
+        asio::read(socket, asio::buffer(reply));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  server.stop();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(connections * round_trips) / elapsed / 1e3
+            << " k round trips/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t connections = 8;
+  std::size_t round_trips = 50'000;
+  std::size_t message_size = 64;
+  std::size_t loops = 2;
+  if (1 < argc) {
+    connections = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    round_trips = std::stoul(argv[2]);
+  }
+  if (3 < argc) {
+    message_size = std::stoul(argv[3]);
+  }
+
+  std::cout << connections << " connection(s), " << round_trips << " x "
+            << message_size << " bytes, " << loops << " loop(s)\n";
+
+  run("asio default", ASIO_CONCURRENCY_HINT_DEFAULT, 2321, loops, connections,
+      round_trips, message_size);
+  run("one thread", 1, 2322, loops, connections, round_trips, message_size);
+  run("unsafe io (default)", fz::net::Loop::DEFAULT_CONCURRENCY_HINT, 2323,
+      loops, connections, round_trips, message_size);
+
+  return 0;
+}
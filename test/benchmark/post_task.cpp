@@ -0,0 +1,137 @@
+// Cross-thread posts to a Loop: throughput of posting tasks from another
+// thread and the latency of one post until the task runs. Compares the
+// former std::function path (taken by value, then copied into asio::post)
+// with Loop::postTask(Task) and batches of Loop::postTasks(), and how many
+// times the inbox had to wake the loop.
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/common/task.h"
+#include "fz/net/loop.h"
+
+using Clock = std::chrono::steady_clock;
+
+// What Loop::postTask() did before it took a Task.
+static auto postFunction(fz::net::Loop& loop, std::function<void(void)> func) {
+  asio::post(loop.getIoContext(), func);
+}
+
+// A capture of typical size: a counter, a shared_ptr and some values.
+static auto makeTask(std::atomic<std::size_t>& done,
+                     const std::shared_ptr<std::uint64_t>& state,
+                     std::uint64_t value) {
+  return [&done, state, value, extra = value * 2] {
+    *state += value + extra;
+    done.fetch_add(1, std::memory_order_release);
+  };
+}
+
+static auto waitFor(const std::atomic<std::size_t>& done, std::size_t n) {
+  while (done.load(std::memory_order_acquire) < n) {
+    std::this_thread::yield();
+  }
+}
+
+static auto throughput(std::string_view name, std::size_t tasks,
+                       std::size_t batch) {
+  auto loop = fz::net::Loop{};
+  loop.start();
+  std::atomic<std::size_t> done{};
+  auto state = std::make_shared<std::uint64_t>();
+
+  auto start = Clock::now();
+  if (batch == 0) {
+    for (std::size_t i = 0; i < tasks; ++i) {
+      postFunction(loop, makeTask(done, state, i));
+    }
+  } else if (batch == 1) {
+    for (std::size_t i = 0; i < tasks; ++i) {
+      loop.postTask(makeTask(done, state, i));
+    }
+  } else {
+    auto pending = std::vector<fz::net::Task>{};
+    pending.reserve(batch);
+    for (std::size_t i = 0; i < tasks; ++i) {
+      pending.emplace_back(makeTask(done, state, i));
+      if (pending.size() == batch) {
+        loop.postTasks(pending);
+        pending.clear();
+      }
+    }
+    loop.postTasks(pending);
+  }
+  waitFor(done, tasks);
+  auto elapsed =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  loop.stop();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(tasks) / elapsed / 1e6 << " M tasks/s";
+  if (auto stats = loop.inboxStats(); stats.tasks != 0) {
+    std::cout << ", " << stats.wakeups << " wakeups for " << stats.tasks
+              << " inbox tasks in " << stats.batches << " batches";
+  }
+  std::cout << "\n";
+}
+
+static auto latency(std::string_view name, std::size_t rounds,
+                    bool function) {
+  auto loop = fz::net::Loop{};
+  loop.start();
+  std::atomic<std::size_t> done{};
+  auto state = std::make_shared<std::uint64_t>();
+  std::atomic<std::int64_t> total_ns{};
+
+  for (std::size_t i = 0; i < rounds; ++i) {
+    auto task = [&, state, posted = Clock::now()] {
+      ++*state;
+      total_ns.fetch_add((Clock::now() - posted).count(),
+                         std::memory_order_relaxed);
+      done.fetch_add(1, std::memory_order_release);
+    };
+    if (function) {
+      postFunction(loop, task);
+    } else {
+      loop.postTask(task);
+    }
+    waitFor(done, i + 1);
+  }
+  loop.stop();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(total_ns.load()) /
+                   static_cast<double>(rounds) / 1e3
+            << " us per post\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t tasks = 2'000'000;
+  std::size_t rounds = 20'000;
+  if (1 < argc) {
+    tasks = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    rounds = std::stoul(argv[2]);
+  }
+
+  std::cout << "throughput, " << tasks << " tasks\n";
+  throughput("std::function", tasks, 0);
+  throughput("Task", tasks, 1);
+  throughput("postTasks x 64", tasks, 64);
+
+  std::cout << "latency, " << rounds << " round(s)\n";
+  latency("std::function", rounds, true);
+  latency("Task", rounds, false);
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+// Bytes copied in user space per send.
+//
+// "legacy" replays the old send path: the caller's Buffer is copied into a
+// std::queue<Buffer> and later appended into one write buffer. "const Buffer&"
+// and "BufferSlice" replay the current path, where queued payloads are only
+// referenced by the iovec batch handed to the kernel.
+
+#include <array>
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <string>
+
+#include "fz/net/common/buffer.h"
+#include "fz/net/common/buffer_slice.h"
+
+static std::atomic<std::size_t> allocated_bytes{0};
+
+auto operator new(std::size_t size) -> void* {
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (auto* p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+auto operator delete(void* p) noexcept -> void { std::free(p); }
+
+auto operator delete(void* p, std::size_t) noexcept -> void { std::free(p); }
+
+struct Result {
+  std::size_t copied{};
+  std::size_t allocated{};
+  std::chrono::nanoseconds elapsed{};
+};
+
+constexpr std::size_t SENDS_PER_FLUSH = 16;
+
+template <typename Push, typename Flush>
+static auto run(std::size_t sends, Push&& push, Flush&& flush) -> Result {
+  auto result = Result{};
+  auto allocated = allocated_bytes.load();
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < sends; ++i) {
+    result.copied += push();
+    if ((i + 1) % SENDS_PER_FLUSH == 0) {
+      result.copied += flush();
+    }
+  }
+  result.copied += flush();
+  result.elapsed = std::chrono::steady_clock::now() - start;
+  result.allocated = allocated_bytes.load() - allocated;
+  return result;
+}
+
+static auto report(std::string_view name, const Result& result,
+                   std::size_t sends) {
+  std::cout << name << ": " << result.copied / sends << " bytes copied/send, "
+            << result.allocated / sends << " bytes allocated/send, "
+            << result.elapsed.count() / sends << " ns/send\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t payload_size = 4096;
+  std::size_t sends = 1'000'000;
+  if (1 < argc) {
+    payload_size = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    sends = std::stoul(argv[2]);
+  }
+
+  auto payload = fz::net::Buffer{};
+  payload.append(std::string(payload_size, 'x'));
+  std::cout << "payload: " << payload_size << " bytes, sends: " << sends
+            << '\n';
+
+  {
+    auto queue = std::queue<fz::net::Buffer>{};
+    auto write_buffer = fz::net::Buffer{};
+    auto result = run(
+        sends,
+        [&] {
+          queue.push(payload);
+          return payload.capacity();
+        },
+        [&] {
+          std::size_t copied = 0;
+          while (!queue.empty()) {
+            auto& buffer = queue.front();
+            write_buffer.append(buffer.readBegin(), buffer.readableBytes());
+            copied += buffer.readableBytes();
+            queue.pop();
+          }
+          write_buffer.retrieve(write_buffer.readableBytes());
+          return copied;
+        });
+    report("legacy", result, sends);
+  }
+
+  auto iovecs = std::array<asio::const_buffer, SENDS_PER_FLUSH>{};
+  auto queue = std::queue<fz::net::BufferSlice>{};
+  auto flush = [&] {
+    std::size_t n = 0;
+    while (!queue.empty()) {
+      iovecs[n++ % iovecs.size()] =
+          asio::const_buffer{queue.front().data(), queue.front().size()};
+      queue.pop();
+    }
+    return std::size_t{0};
+  };
+
+  {
+    auto result = run(
+        sends,
+        [&] {
+          queue.emplace(std::string_view{payload.readBegin(),
+                                         payload.readableBytes()});
+          return payload.readableBytes();
+        },
+        flush);
+    report("const Buffer&", result, sends);
+  }
+
+  {
+    auto shared = fz::net::BufferSlice{fz::net::Buffer{payload}};
+    auto result = run(
+        sends,
+        [&] {
+          queue.push(shared);
+          return std::size_t{0};
+        },
+        flush);
+    report("BufferSlice", result, sends);
+  }
+
+  return 0;
+}
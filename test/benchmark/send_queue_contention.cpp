@@ -0,0 +1,164 @@
+// N producer threads feeding the outbound queue of one session, drained by
+// one consumer thread: std::mutex + std::queue (the old queue) against the
+// intrusive MpscQueue used by Session, with a new node per send and with
+// nodes from a NodeCache. The last case sends from the consumer thread
+// itself, as a read callback on the loop does, where every node is reused.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/common/buffer_slice.h"
+#include "fz/net/common/mpsc_queue.h"
+#include "fz/net/common/node_cache.h"
+
+struct Node : fz::net::MpscNode {
+  explicit Node(fz::net::BufferSlice slice) : _slice{std::move(slice)} {}
+
+  fz::net::BufferSlice _slice;
+};
+
+template <typename Push, typename Drain>
+static auto run(std::string_view name, std::size_t producers,
+                std::size_t per_producer, Push&& push, Drain&& drain) {
+  const auto total = producers * per_producer;
+  auto payload = fz::net::BufferSlice{std::string_view{"payload"}};
+  auto go = std::atomic<bool>{false};
+
+  auto threads = std::vector<std::thread>{};
+  for (std::size_t i = 0; i < producers; ++i) {
+    threads.emplace_back([&] {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      for (std::size_t n = 0; n < per_producer; ++n) {
+        push(payload);
+      }
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::size_t consumed = 0;
+  while (consumed < total) {
+    consumed += drain();
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(total) / elapsed / 1e6 << " Msends/s\n";
+}
+
+constexpr std::size_t BURST = 16;
+
+// A burst of sends followed by the flush that drains them, all on one
+// thread.
+template <typename Make, typename Recycle>
+static auto inLoop(std::string_view name, std::size_t sends, Make&& make,
+                   Recycle&& recycle) {
+  auto payload = fz::net::BufferSlice{std::string_view{"payload"}};
+  auto queue = fz::net::MpscQueue<Node>{};
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t sent = 0; sent < sends; sent += BURST) {
+    for (std::size_t n = 0; n < BURST; ++n) {
+      queue.push(make(payload));
+    }
+    while (auto* node = queue.pop()) {
+      recycle(node);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::cout << "  " << name << ": "
+            << static_cast<double>(sends) / elapsed / 1e6 << " Msends/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t per_producer = 1'000'000;
+  if (1 < argc) {
+    per_producer = std::stoul(argv[1]);
+  }
+
+  auto max_producers = std::max(4U, std::thread::hardware_concurrency());
+  for (std::size_t producers = 1; producers <= max_producers; producers *= 2) {
+    std::cout << producers << " producer(s), " << per_producer
+              << " sends each\n";
+
+    {
+      auto mutex = std::mutex{};
+      auto queue = std::queue<fz::net::BufferSlice>{};
+      run(
+          "mutex + std::queue", producers, per_producer,
+          [&](const auto& slice) {
+            std::scoped_lock lock(mutex);
+            queue.push(slice);
+          },
+          [&] {
+            std::size_t n = 0;
+            std::scoped_lock lock(mutex);
+            while (!queue.empty()) {
+              queue.pop();
+              ++n;
+            }
+            return n;
+          });
+    }
+
+    {
+      auto queue = fz::net::MpscQueue<Node>{};
+      run(
+          "MpscQueue", producers, per_producer,
+          [&](const auto& slice) { queue.push(new Node{slice}); },
+          [&] {
+            std::size_t n = 0;
+            while (auto* node = queue.pop()) {
+              delete node;
+              ++n;
+            }
+            return n;
+          });
+    }
+
+    {
+      auto queue = fz::net::MpscQueue<Node>{};
+      run(
+          "MpscQueue + NodeCache", producers, per_producer,
+          [&](const auto& slice) {
+            queue.push(fz::net::NodeCache<Node>::make(slice));
+          },
+          [&] {
+            std::size_t n = 0;
+            while (auto* node = queue.pop()) {
+              fz::net::NodeCache<Node>::recycle(node);
+              ++n;
+            }
+            return n;
+          });
+    }
+  }
+
+  std::cout << "sends from the consumer thread, " << per_producer
+            << " in bursts of " << BURST << '\n';
+  inLoop("MpscQueue", per_producer, [](auto slice) { return new Node{slice}; },
+         [](auto* node) { delete node; });
+  inLoop(
+      "MpscQueue + NodeCache", per_producer,
+      [](auto slice) { return fz::net::NodeCache<Node>::make(slice); },
+      [](auto* node) { fz::net::NodeCache<Node>::recycle(node); });
+
+  return 0;
+}
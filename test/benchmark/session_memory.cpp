@@ -0,0 +1,160 @@
+// Resident memory per idle connection: open N connections to an in-process
+// TcpServer, send one small message on each, let them sit idle and divide the
+// growth of the resident set by N. A second round after closing them all
+// shows how much of it the session pool hands out again instead of
+// allocating. Pass "shared" to receive into the per-loop shared buffer.
+//
+// Needs about 2 * N file descriptors; the soft limit is raised to the hard
+// one. Client sockets are spread over several loopback source addresses so
+// they do not run out of ephemeral ports.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+static auto residentBytes() -> std::size_t {
+  auto statm = std::ifstream{"/proc/self/statm"};
+  std::size_t size = 0;
+  std::size_t resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+static auto raiseFdLimit() -> std::size_t {
+  auto limit = rlimit{};
+  ::getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &limit);
+  return static_cast<std::size_t>(limit.rlim_cur);
+}
+
+// Connections per loopback source address, below the ephemeral port range.
+constexpr std::size_t CONNECTIONS_PER_SOURCE = 20'000;
+
+static auto openConnections(std::size_t count, std::uint16_t port,
+                            std::uint32_t first_source)
+    -> std::vector<int> {
+  auto fds = std::vector<int>{};
+  fds.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    auto source = sockaddr_in{};
+    source.sin_family = AF_INET;
+    source.sin_addr.s_addr = htonl(
+        first_source + static_cast<std::uint32_t>(i / CONNECTIONS_PER_SOURCE));
+    auto target = sockaddr_in{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&source), sizeof(source)) < 0 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) <
+            0) {
+      std::cerr << "connection " << i << " failed\n";
+      std::exit(1);
+    }
+    if (::send(fd, "ping", 4, 0) != 4) {
+      std::cerr << "send on connection " << i << " failed\n";
+      std::exit(1);
+    }
+    fds.push_back(fd);
+  }
+  return fds;
+}
+
+static auto waitFor(const std::atomic<std::size_t>& counter,
+                    std::size_t value) {
+  while (counter.load() < value) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+int main(int argc, char* argv[]) {
+  std::uint16_t port = 2316;
+  std::size_t connections = 100'000;
+  std::size_t loops = 4;
+  if (1 < argc) {
+    connections = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    loops = std::stoul(argv[2]);
+  }
+  const auto shared = 3 < argc && std::string_view{argv[3]} == "shared";
+
+  auto fd_limit = raiseFdLimit();
+  if (fd_limit < 2 * connections + 64) {
+    std::cerr << "fd limit " << fd_limit << " is too low for " << connections
+              << " connections\n";
+    return 1;
+  }
+
+  auto received = std::atomic<std::size_t>{};
+  auto disconnected = std::atomic<std::size_t>{};
+  fz::net::TcpServer server{loops, "127.0.0.1", port};
+  server.setNewSessionCallback<fz::net::Session>();
+  server.setSharedReadBuffer(shared);
+  server.setReadCallback([&received](const auto&, auto& buffer) {
+    buffer.retrieve(buffer.readableBytes());
+    ++received;
+  });
+  server.setDisconnectCallback(
+      [&disconnected](const auto&) { ++disconnected; });
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::cout << connections << " idle connections on " << loops
+            << " loop(s), sizeof(Session) = " << sizeof(fz::net::Session)
+            << " bytes, " << (shared ? "shared" : "per-session")
+            << " read buffers\n";
+
+  auto report = [connections](std::string_view name, std::size_t before) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto after = residentBytes();
+    auto grown = after < before ? 0 : after - before;
+    std::cout << "  " << name << ": " << grown / connections
+              << " bytes per session\n";
+  };
+
+  auto first_source = std::uint32_t{INADDR_LOOPBACK} + 1;
+  auto before = residentBytes();
+  auto fds = openConnections(connections, port, first_source);
+  waitFor(received, connections);
+  report("first round", before);
+
+  for (auto fd : fds) {
+    ::close(fd);
+  }
+  waitFor(disconnected, connections);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // Fresh source addresses; the old ports sit in TIME_WAIT.
+  first_source += static_cast<std::uint32_t>(
+      connections / CONNECTIONS_PER_SOURCE + 1);
+  before = residentBytes();
+  fds = openConnections(connections, port, first_source);
+  waitFor(received, 2 * connections);
+  report("second round (recycled)", before);
+
+  for (auto fd : fds) {
+    ::close(fd);
+  }
+  waitFor(disconnected, 2 * connections);
+  server.stop();
+  return 0;
+}
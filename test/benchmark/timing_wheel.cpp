@@ -0,0 +1,81 @@
+// Idle timeouts of many connections: pushing the timeout back on every read
+// with one steady_timer per connection (cancel + re-arm in the timer heap)
+// against one TimingWheel per loop (a store per refresh).
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fz/net/timing_wheel.h"
+
+template <typename Refresh>
+static auto run(std::string_view name, std::size_t timers,
+                std::size_t refreshes, Refresh&& refresh) {
+  auto rng = std::mt19937_64{42};
+  auto pick = std::uniform_int_distribution<std::size_t>{0, timers - 1};
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t n = 0; n < refreshes; ++n) {
+    refresh(pick(rng));
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  std::cout << "  " << name << ": " << elapsed / static_cast<double>(refreshes)
+            << " ns/refresh\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::size_t timers = 500'000;
+  std::size_t refreshes = 5'000'000;
+  if (1 < argc) {
+    timers = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    refreshes = std::stoul(argv[2]);
+  }
+
+  const auto timeout = std::chrono::seconds{30};
+  std::cout << timers << " timers, " << refreshes << " refreshes\n";
+
+  {
+    asio::io_context io_context;
+    auto steady_timers = std::vector<std::unique_ptr<asio::steady_timer>>{};
+    steady_timers.reserve(timers);
+    for (std::size_t i = 0; i < timers; ++i) {
+      steady_timers.push_back(std::make_unique<asio::steady_timer>(io_context));
+      steady_timers.back()->expires_after(timeout);
+      steady_timers.back()->async_wait([](const auto&) {});
+    }
+
+    run("asio::steady_timer", timers, refreshes, [&](std::size_t i) {
+      steady_timers[i]->expires_after(timeout);
+      steady_timers[i]->async_wait([](const auto&) {});
+    });
+
+    // Complete the cancelled waits before the timers go away.
+    steady_timers.clear();
+    io_context.run();
+  }
+
+  {
+    asio::io_context io_context;
+    fz::net::TimingWheel wheel{io_context};
+    auto ids = std::vector<fz::net::TimingWheel::TimerId>{};
+    ids.reserve(timers);
+    for (std::size_t i = 0; i < timers; ++i) {
+      ids.push_back(wheel.add(timeout, [] {}));
+    }
+
+    run("TimingWheel", timers, refreshes,
+        [&](std::size_t i) { wheel.refresh(ids[i], timeout); });
+  }
+
+  return 0;
+}
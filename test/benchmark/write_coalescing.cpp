@@ -0,0 +1,85 @@
+// Small messages sent from worker threads to one session: write syscalls per
+// message and throughput. Before write coalescing every send posted its own
+// task and most of them ended in their own write.
+
+#include <asio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+int main(int argc, char* argv[]) {
+  std::uint16_t port = 2315;
+  std::size_t messages = 1'000'000;
+  std::size_t producers = 4;
+  std::size_t message_size = 32;
+  if (1 < argc) {
+    messages = std::stoul(argv[1]);
+  }
+  if (2 < argc) {
+    producers = std::stoul(argv[2]);
+  }
+  if (3 < argc) {
+    message_size = std::stoul(argv[3]);
+  }
+
+  auto connected = std::promise<std::shared_ptr<fz::net::Session>>{};
+  fz::net::TcpServer server{1, "127.0.0.1", port};
+  server.setNewSessionCallback<fz::net::Session>();
+  server.setConnectCallback(
+      [&connected](const auto& session) { connected.set_value(session); });
+  server.start();
+
+  asio::io_context io_context;
+  auto client = asio::ip::tcp::socket{io_context};
+  client.connect({asio::ip::make_address("127.0.0.1"), port});
+  auto session = connected.get_future().get();
+
+  const auto per_producer = messages / producers;
+  const auto total_bytes = per_producer * producers * message_size;
+  auto reader = std::thread([&client, total_bytes] {
+    auto buffer = std::vector<char>(64 * 1024);
+    std::size_t received = 0;
+    while (received < total_bytes) {
+      received += client.read_some(asio::buffer(buffer));
+    }
+  });
+
+  auto payload = fz::net::BufferSlice{std::string(message_size, 'x')};
+  auto start = std::chrono::steady_clock::now();
+  auto threads = std::vector<std::thread>{};
+  for (std::size_t i = 0; i < producers; ++i) {
+    threads.emplace_back([&] {
+      for (std::size_t n = 0; n < per_producer; ++n) {
+        session->send(payload);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  reader.join();
+  auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  const auto sent = per_producer * producers;
+  std::cout << producers << " producer(s), " << sent << " x " << message_size
+            << " bytes\n"
+            << "  " << static_cast<double>(sent) / elapsed / 1e6
+            << " Mmsg/s\n"
+            << "  " << session->writeCalls() << " write syscalls, "
+            << static_cast<double>(session->writeCalls()) / sent
+            << " per message\n";
+
+  client.close();
+  server.stop();
+  return 0;
+}
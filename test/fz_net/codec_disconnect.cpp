@@ -0,0 +1,59 @@
+// Two frames arrive in one read and the first message callback disconnects
+// the session: the second frame must not be delivered. Exits non-zero if
+// it is.
+
+#include <asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "fz/net/codec.h"
+#include "fz/net/session.h"
+#include "fz/net/tcp_server.h"
+
+int main(int argc, char *argv[]) {
+  std::uint16_t port = 2316;
+
+  if (1 < argc) {
+    port = std::stoi(argv[1]);
+  }
+
+  std::atomic<int> messages{};
+  fz::net::TcpServer server{1, "127.0.0.1", port};
+  server.setNewSessionCallback<fz::net::Session>();
+  server.setCodec(std::make_shared<fz::net::LineCodec>("\n"));
+  server.setMessageCallback([&messages](const auto &session, auto message) {
+    std::cout << "message: " << message << '\n';
+    messages.fetch_add(1);
+    session->disconnect();
+  });
+  server.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  {
+    asio::io_context io_context;
+    auto socket = asio::ip::tcp::socket{io_context};
+    socket.connect({asio::ip::make_address("127.0.0.1"), port});
+    asio::write(socket, asio::buffer(std::string{"first\nsecond\n"}));
+
+    // The server closes the connection after the first message.
+    auto ec = asio::error_code{};
+    char byte = 0;
+    while (!ec) {
+      socket.read_some(asio::buffer(&byte, 1), ec);
+    }
+  }
+  server.stop();
+
+  if (messages.load() != 1) {
+    std::cout << "FAILED: " << messages.load() << " messages delivered\n";
+    return 1;
+  }
+
+  std::cout << "OK\n";
+  return 0;
+}
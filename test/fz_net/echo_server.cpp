@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include "fz/net/session.h"
 #include "fz/net/tcp_server.h"
@@ -37,7 +38,7 @@ int main(int argc, char *argv[]) {
 
     auto send = fz::net::Buffer{};
     send.append(str);
-    session->send(send);
+    session->send(std::move(send));
   });
   server.start();
 
@@ -3,8 +3,8 @@
 #include <utility>
 
 #include "asio/io_context.hpp"
+#include "fz/net/basic_tcp_server.h"
 #include "fz/net/session.h"
-#include "fz/net/tcp_server.h"
 
 constexpr inline std::string_view CRLF = "\r\n";
 constexpr inline std::string_view COLON = ": ";
@@ -296,6 +296,7 @@ class HttpRequestParse {
     _status = Status::RequestLine;
     _request.clear();
     _data.clear();
+    _scanned = 0;
     _body_size = std::numeric_limits<std::size_t>::max();
   }
 
@@ -303,6 +304,7 @@ class HttpRequestParse {
     _status = Status::INVALID;
     _request.clear();
     _data.clear();
+    _scanned = 0;
     _body_size = std::numeric_limits<std::size_t>::max();
   }
 
@@ -316,6 +318,24 @@ class HttpRequestParse {
       return;
     }
 
+    if (status() != Status::Body) {
+      // Nothing to parse before a full line arrived. Keep the bytes in the
+      // buffer and resume the scan where the last read stopped.
+      const auto split_crlf = !_data.empty() && _data.back() == '\r' &&
+                              *buffer.readBegin() == '\n';
+      if (!split_crlf &&
+          buffer.findCRLF(_scanned) == fz::net::Buffer::npos) {
+        if (MAX_REQUEST_LINE_SIZE < _data.size() + buffer.readableBytes()) {
+          markAsInvalid();
+          return;
+        }
+
+        _scanned = buffer.readableBytes() - 1;
+        return;
+      }
+    }
+
+    _scanned = 0;
     _data += buffer.retrieveAllAsString();
     while (parse()) {
     }
@@ -389,42 +409,17 @@ class HttpRequestParse {
   Status _status{Status::RequestLine};
   HttpRequest _request;
   std::string _data;
+  std::size_t _scanned{};
   std::size_t _body_size{std::numeric_limits<std::size_t>::max()};
 };
 
-class HttpSession : public fz::net::Session {
+class HttpHandler {
  public:
-  explicit HttpSession(std::shared_ptr<fz::net::Loop> loop)
-      : fz::net::Session{std::move(loop)} {}
-
-  auto parseRequest(fz::net::Buffer& buffer) -> void {
-    _http_request_parse.run(buffer);
-  }
-
-  auto& httpRequestParse() const { return _http_request_parse; }
-
- private:
-  HttpRequestParse _http_request_parse;
-};
-
-int main() {
-  asio::io_context io_context;
-
-  fz::net::TcpServer server{2, "0.0.0.0", 80};
-  server.setNewSessionCallback<HttpSession>();
-  server.setReadCallback([](const auto& session, auto& buffer) {
-    auto http_session = std::dynamic_pointer_cast<HttpSession>(session);
-    if (!http_session) {
-      std::cerr << "dynamic_pointer_cast failed\n";
-      std::terminate();
-    }
-
+  auto onRead(fz::net::Session& session, fz::net::Buffer& buffer) -> void {
     std::cout << "read callback\n";
-    http_session->parseRequest(buffer);
-    if (http_session->httpRequestParse().status() ==
-        HttpRequestParse::Status::OK) {
-      std::cout << http_session->httpRequestParse().request().toString()
-                << '\n';
+    _http_request_parse.run(buffer);
+    if (_http_request_parse.status() == HttpRequestParse::Status::OK) {
+      std::cout << _http_request_parse.request().toString() << '\n';
 
       auto http_response_buffer = fz::net::Buffer();
       http_response_buffer.append("HTTP/1.1 200 OK\r\n");
@@ -434,12 +429,18 @@ int main() {
       http_response_buffer.append("\r\n");
       http_response_buffer.append("hello world");
 
-      http_session->send(http_response_buffer);
+      session.send(std::move(http_response_buffer));
     }
   }
 
-  );
+ private:
+  HttpRequestParse _http_request_parse;
+};
+
+int main() {
+  asio::io_context io_context;
 
+  fz::net::BasicTcpServer<HttpHandler> server{2, "0.0.0.0", 80};
   server.start();
 
   asio::signal_set signals(io_context, SIGINT, SIGTERM);
@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include "asio/io_context.hpp"
 #include "fz/net/loop.h"
@@ -36,7 +37,7 @@ int main(int argc, char *argv[]) {
 
         auto buffer = fz::net::Buffer{};
         buffer.append(line);
-        session->send(buffer);
+        session->send(std::move(buffer));
       }
 
       std::cout << std::this_thread::get_id() << " Disconnect from "